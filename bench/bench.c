@@ -0,0 +1,290 @@
+/** @file bench.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Headless benchmark for the host.  Every map in the resource file is
+ *  loaded and run for a number of frames of scripted input on a fixed
+ *  clock; the load time, the frame time percentiles and the memory
+ *  usage per map are written to stdout.  With --render-thread, frames
+ *  are rendered on a thread of their own and the frame times are those
+ *  of the simulation.
+ *
+ *  Usage: ngine_bench [resource file] [frames per map] [--render-thread]
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ngine.h"
+
+#define BENCH_RES_FILE  "data.pfs"
+#define BENCH_FRAMES    600
+#define BENCH_STEP_MS   20
+#define BENCH_MAX_MAPS  32
+#define BENCH_NAME_SIZE 85
+
+typedef struct bench_maps
+{
+    char   name[BENCH_MAX_MAPS][BENCH_NAME_SIZE];
+    Sint32 count;
+
+} bench_maps_t;
+
+typedef struct bench_step
+{
+    Sint32      frames;
+    SDL_Keycode key;
+
+} bench_step_t;
+
+// Walks around in a square, jumping at every corner in platformer maps.
+static const bench_step_t script[] =
+{
+    { 60, SDLK_RIGHT },
+    {  2, SDLK_UP    },
+    { 60, SDLK_DOWN  },
+    {  2, SDLK_UP    },
+    { 60, SDLK_LEFT  },
+    { 30, SDLK_UP    },
+    { 20, 0          }
+};
+
+static const char* tag_name[MEM_TAG_COUNT] = { "map", "entity", "path", "render", "tiled", "scratch", "texture", "audio" };
+
+static void add_map(const char* path, void* data)
+{
+    bench_maps_t* maps   = (bench_maps_t*)data;
+    size_t        length = SDL_strlen(path);
+
+    if (length < 4 || 0 != SDL_strcmp(path + length - 4, ".tmj") || maps->count >= BENCH_MAX_MAPS)
+    {
+        return;
+    }
+
+    SDL_strlcpy(maps->name[maps->count], path, BENCH_NAME_SIZE);
+    maps->count += 1;
+}
+
+static void push_key(SDL_Keycode key, SDL_bool is_down)
+{
+    SDL_Event event;
+
+    if (! key)
+    {
+        return;
+    }
+
+    SDL_zero(event);
+    event.type           = is_down ? SDL_KEYDOWN : SDL_KEYUP;
+    event.key.state      = is_down ? SDL_PRESSED : SDL_RELEASED;
+    event.key.timestamp  = SDL_GetTicks();
+    event.key.keysym.sym = key;
+
+    SDL_PushEvent(&event);
+}
+
+// Presses and releases the keys of the script for the given frame.
+static void play_script(Sint32 frame)
+{
+    Sint32 length = 0;
+    Sint32 index;
+
+    for (index = 0; index < (Sint32)SDL_arraysize(script); index += 1)
+    {
+        length += script[index].frames;
+    }
+
+    frame %= length;
+
+    for (index = 0; index < (Sint32)SDL_arraysize(script); index += 1)
+    {
+        if (0 == frame)
+        {
+            push_key(script[index].key, SDL_TRUE);
+            return;
+        }
+
+        frame -= script[index].frames;
+
+        if (0 == frame)
+        {
+            push_key(script[index].key, SDL_FALSE);
+            if (index + 1 < (Sint32)SDL_arraysize(script))
+            {
+                push_key(script[index + 1].key, SDL_TRUE);
+            }
+            return;
+        }
+    }
+}
+
+static Uint32 get_elapsed_us(Uint64 start)
+{
+    return (Uint32)(((SDL_GetPerformanceCounter() - start) * 1000000) / SDL_GetPerformanceFrequency());
+}
+
+static int compare_us(const void* a, const void* b)
+{
+    Uint32 value_a = *(const Uint32*)a;
+    Uint32 value_b = *(const Uint32*)b;
+
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+static void print_ms(const char* label, Uint32 us)
+{
+    printf("  %-5s %5u.%03u ms\n", label, us / 1000, us % 1000);
+}
+
+static status_t run_map(const char* map_name, Sint32 frame_count, Uint32* frame_us, ngine_t* core)
+{
+    status_t status;
+    Uint64   start;
+    Uint32   load_us;
+    Sint32   load_opens;
+    Sint32   load_bytes;
+    Sint32   last_frame;
+    Sint32   frame;
+    Sint32   tag;
+
+    start   = SDL_GetPerformanceCounter();
+    status  = ng_load_map(map_name, core);
+    load_us = get_elapsed_us(start);
+
+    printf("%s\n", map_name);
+
+    if (NG_OK != status)
+    {
+        printf("  could not be loaded\n");
+        return status;
+    }
+
+    for (frame = 0; frame < frame_count; frame += 1)
+    {
+        play_script(frame);
+
+        start           = SDL_GetPerformanceCounter();
+        status          = ng_update(core);
+        frame_us[frame] = get_elapsed_us(start);
+
+        if (NG_OK != status)
+        {
+            break;
+        }
+    }
+
+    // The script ends with all keys up.
+    push_key(SDLK_UP,    SDL_FALSE);
+    push_key(SDLK_DOWN,  SDL_FALSE);
+    push_key(SDLK_LEFT,  SDL_FALSE);
+    push_key(SDLK_RIGHT, SDL_FALSE);
+
+    qsort(frame_us, (size_t)frame, sizeof(Uint32), compare_us);
+
+    print_ms("load", load_us);
+    ng_get_stats(STAT_FILE_OPENS, &last_frame, &load_opens, core);
+    ng_get_stats(STAT_FILE_BYTES, &last_frame, &load_bytes, core);
+    printf("  %d file reads, %d bytes\n", load_opens, load_bytes);
+    if (frame > 0)
+    {
+        print_ms("p50", frame_us[(frame - 1) * 50 / 100]);
+        print_ms("p90", frame_us[(frame - 1) * 90 / 100]);
+        print_ms("p99", frame_us[(frame - 1) * 99 / 100]);
+        print_ms("max", frame_us[frame - 1]);
+    }
+    printf("  %d frames\n", frame);
+
+    // Peaks are since the start of the benchmark.
+    for (tag = 0; tag < MEM_TAG_COUNT; tag += 1)
+    {
+        Sint32 current = 0;
+        Sint32 peak    = 0;
+        Sint32 count   = 0;
+
+        ng_get_memory_usage((mem_tag_t)tag, &current, &peak, &count, core);
+        printf("  %-7s %8d B  peak %8d B  %5d allocs\n", tag_name[tag], current, peak, count);
+    }
+
+    ng_unload_map(core);
+
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    const char*  res_file    = BENCH_RES_FILE;
+    Sint32       frame_count = BENCH_FRAMES;
+    int          result      = 0;
+    ngine_t*     core        = NULL;
+    Uint32*      frame_us;
+    bench_maps_t maps;
+    Sint32       index;
+
+    if (argc > 1)
+    {
+        res_file = argv[1];
+    }
+    if (argc > 2)
+    {
+        frame_count = SDL_max(SDL_atoi(argv[2]), 1);
+    }
+
+    // No window, no vsync, no sound card; the mixer still runs.
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+
+    SDL_zero(maps);
+    init_file_reader(res_file);
+    list_files(add_map, &maps);
+    if (0 == maps.count)
+    {
+        printf("No maps found in %s.\n", res_file);
+        return 1;
+    }
+
+    frame_us = (Uint32*)malloc((size_t)frame_count * sizeof(Uint32));
+    if (! frame_us)
+    {
+        return 1;
+    }
+
+    if (NG_OK != ng_init(res_file, "ngine_bench", &core))
+    {
+        printf("Could not initialise the engine.\n");
+        free(frame_us);
+        return 1;
+    }
+
+    // Same work every run, regardless of how fast the host is.
+    ng_set_fixed_time_step(BENCH_STEP_MS, core);
+    ng_set_behaviour_budget(0, core);
+
+    if (argc > 3 && 0 == SDL_strcmp(argv[3], "--render-thread"))
+    {
+        if (NG_OK != ng_use_render_thread(SDL_TRUE, core))
+        {
+            printf("Could not start the render thread.\n");
+            ng_free(core);
+            free(frame_us);
+            return 1;
+        }
+    }
+
+    for (index = 0; index < maps.count; index += 1)
+    {
+        if (NG_OK != run_map(maps.name[index], frame_count, frame_us, core))
+        {
+            result = 1;
+        }
+    }
+
+    ng_free(core);
+    free(frame_us);
+
+    return result;
+}
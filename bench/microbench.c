@@ -0,0 +1,449 @@
+/** @file microbench.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Microbenchmarks of the engine's hot functions on the host.  Every
+ *  case is run for as many rounds as fit into a sample of at least
+ *  BENCH_SAMPLE_MS; of BENCH_SAMPLES samples, the minimum and median
+ *  time per operation are reported, along with the allocations made by
+ *  the engine's allocator per operation.  Cases on the files of the
+ *  resource file are listed separately; cases on map data are run for
+ *  every map in it.
+ *
+ *  Usage: ngine_microbench [resource file]
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ngine.h"
+
+#define BENCH_RES_FILE   "data.pfs"
+#define BENCH_SAMPLES    7
+#define BENCH_SAMPLE_MS  20
+#define BENCH_MAX_FILES  64
+#define BENCH_NAME_SIZE  85
+#define BENCH_PROPERTIES 24
+
+typedef Uint32 (*case_function_t)(Sint32 rounds, ngine_t* core);
+
+typedef struct bench_files
+{
+    char   name[BENCH_MAX_FILES][BENCH_NAME_SIZE];
+    Sint32 count;
+
+} bench_files_t;
+
+static bench_files_t         files;
+static cute_tiled_property_t properties[BENCH_PROPERTIES];
+static char                  property_name[BENCH_PROPERTIES][16];
+static Uint8                 file_buffer[0x10000];
+static volatile Uint64       sink;
+
+// Typical property names, as found in the maps.
+static const char* hash_name[] =
+{
+    "gravity",
+    "is_platformer",
+    "meter_in_pixel",
+    "jump_height",
+    "entity_capacity",
+    "sprite_sheet_id",
+    "animation_speed",
+    "tilelayer",
+    "objectgroup"
+};
+
+static const char* text =
+    "The quick brown fox jumps over the lazy dog. "
+    "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG! "
+    "0123456789 ,.;:?!-_'\"()[]/\\ the lazy dog sleeps.";
+
+static void add_file(const char* path, void* data)
+{
+    bench_files_t* list = (bench_files_t*)data;
+
+    if (list->count < BENCH_MAX_FILES)
+    {
+        SDL_strlcpy(list->name[list->count], path, BENCH_NAME_SIZE);
+        list->count += 1;
+    }
+}
+
+static SDL_bool is_map_file(const char* name)
+{
+    size_t length = SDL_strlen(name);
+
+    return (length >= 4 && 0 == SDL_strcmp(name + length - 4, ".tmj")) ? SDL_TRUE : SDL_FALSE;
+}
+
+// Synthetic property list.  Half of the lookups are misses, which walk
+// the entire list.
+static void init_properties(void)
+{
+    Sint32 index;
+
+    for (index = 0; index < BENCH_PROPERTIES; index += 1)
+    {
+        SDL_snprintf(property_name[index], sizeof(property_name[index]), "property_%02d", index);
+
+        properties[index].name.ptr     = property_name[index];
+        properties[index].type         = CUTE_TILED_PROPERTY_INT;
+        properties[index].data.integer = index;
+    }
+}
+
+static Uint32 run_hash(Sint32 rounds, ngine_t* core)
+{
+    Uint32 ops = 0;
+    Sint32 round;
+    Sint32 index;
+
+    (void)core;
+
+    for (round = 0; round < rounds; round += 1)
+    {
+        for (index = 0; index < (Sint32)SDL_arraysize(hash_name); index += 1)
+        {
+            sink += generate_hash((const unsigned char*)hash_name[index]);
+            ops  += 1;
+        }
+    }
+
+    return ops;
+}
+
+static Uint32 run_property(Sint32 rounds, ngine_t* core)
+{
+    Uint64 hash[BENCH_PROPERTIES];
+    Uint32 ops = 0;
+    Sint32 round;
+    Sint32 index;
+
+    for (index = 0; index < BENCH_PROPERTIES; index += 1)
+    {
+        hash[index] = generate_hash((const unsigned char*)property_name[index]);
+        if (index & 1)
+        {
+            hash[index] += 1;
+        }
+    }
+
+    for (round = 0; round < rounds; round += 1)
+    {
+        for (index = 0; index < BENCH_PROPERTIES; index += 1)
+        {
+            sink += (Uint64)get_integer_property(hash[index], properties, BENCH_PROPERTIES, core);
+            ops  += 1;
+        }
+    }
+
+    return ops;
+}
+
+static Uint32 run_pfs_size(Sint32 rounds, ngine_t* core)
+{
+    Uint32 ops = 0;
+    Sint32 round;
+    Sint32 index;
+
+    (void)core;
+
+    for (round = 0; round < rounds; round += 1)
+    {
+        for (index = 0; index < files.count; index += 1)
+        {
+            sink += size_of_file(files.name[index]);
+            ops  += 1;
+        }
+    }
+
+    return ops;
+}
+
+static Uint32 run_pfs_read(Sint32 rounds, ngine_t* core)
+{
+    Uint32 ops = 0;
+    Sint32 round;
+    Sint32 index;
+
+    (void)core;
+
+    for (round = 0; round < rounds; round += 1)
+    {
+        for (index = 0; index < files.count; index += 1)
+        {
+            sink += read_binary_file_from_path(files.name[index], file_buffer, sizeof(file_buffer));
+            ops  += 1;
+        }
+    }
+
+    return ops;
+}
+
+static Uint32 run_resource(Sint32 rounds, ngine_t* core)
+{
+    Uint32 ops = 0;
+    Sint32 round;
+    Sint32 index;
+
+    for (round = 0; round < rounds; round += 1)
+    {
+        for (index = 0; index < files.count; index += 1)
+        {
+            Uint32 size;
+            Uint8* resource = load_resource(files.name[index], &size, core);
+
+            if (resource)
+            {
+                sink += resource[0];
+                free_scratch(resource, &core->load_arena);
+            }
+            ops += 1;
+        }
+    }
+
+    return ops;
+}
+
+static Uint32 run_text(Sint32 rounds, ngine_t* core)
+{
+    Sint32 round;
+
+    for (round = 0; round < rounds; round += 1)
+    {
+        render_text(text, core);
+        SDL_RenderFlush(core->renderer);
+    }
+
+    return (Uint32)rounds;
+}
+
+static Uint32 run_debug_text(Sint32 rounds, ngine_t* core)
+{
+    Sint32 round;
+
+    for (round = 0; round < rounds; round += 1)
+    {
+        render_debug_text(text, 0, 0, core);
+        SDL_RenderFlush(core->renderer);
+    }
+
+    return (Uint32)rounds;
+}
+
+static Uint32 run_map_property(Sint32 rounds, ngine_t* core)
+{
+    cute_tiled_map_t* handle = core->map->handle;
+    Uint32            ops    = 0;
+    Sint32            round;
+    Sint32            index;
+
+    for (round = 0; round < rounds; round += 1)
+    {
+        for (index = 0; index < handle->property_count; index += 1)
+        {
+            Uint64 hash = generate_hash((const unsigned char*)handle->properties[index].name.ptr);
+
+            sink += (Uint64)(size_t)get_string_map_property(hash, core);
+            ops  += 1;
+        }
+
+        // A miss walks the entire list.
+        sink += (Uint64)(size_t)get_string_map_property(0, core);
+        ops  += 1;
+    }
+
+    return ops;
+}
+
+static Uint32 run_tile_index(Sint32 rounds, ngine_t* core)
+{
+    Sint32 step_x = get_tile_width(core->map->handle)  / 2;
+    Sint32 step_y = get_tile_height(core->map->handle) / 2;
+    Uint32 ops    = 0;
+    Sint32 round;
+    Sint32 pos_x;
+    Sint32 pos_y;
+
+    for (round = 0; round < rounds; round += 1)
+    {
+        for (pos_y = 0; pos_y < core->map->height; pos_y += step_y)
+        {
+            for (pos_x = 0; pos_x < core->map->width; pos_x += step_x)
+            {
+                sink += (Uint64)get_tile_index(pos_x, pos_y, core);
+                ops  += 1;
+            }
+        }
+    }
+
+    return ops;
+}
+
+static Uint32 run_tile_animated(Sint32 rounds, ngine_t* core)
+{
+    cute_tiled_map_t*   handle = core->map->handle;
+    cute_tiled_layer_t* layer;
+    Uint32              ops    = 0;
+    Sint32              round;
+    Sint32              index;
+
+    for (round = 0; round < rounds; round += 1)
+    {
+        for (layer = handle->layers; layer; layer = layer->next)
+        {
+            for (index = 0; index < layer->data_count; index += 1)
+            {
+                Sint32 gid = layer->data[index];
+
+                if (gid)
+                {
+                    sink += (Uint64)is_tile_animated(gid, NULL, NULL, handle);
+                    ops  += 1;
+                }
+            }
+        }
+    }
+
+    return ops;
+}
+
+static int compare_ns(const void* a, const void* b)
+{
+    Uint64 value_a = *(const Uint64*)a;
+    Uint64 value_b = *(const Uint64*)b;
+
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+static Uint64 get_elapsed_ns(Uint64 start)
+{
+    return ((SDL_GetPerformanceCounter() - start) * 1000000000) / SDL_GetPerformanceFrequency();
+}
+
+// Picks the number of rounds per sample first, so that short cases are
+// not dominated by the resolution of the timer.
+static void run_case(const char* name, case_function_t function, ngine_t* core)
+{
+    Uint64 sample[BENCH_SAMPLES];
+    Uint64 elapsed;
+    Uint64 start;
+    Sint32 rounds = 1;
+    Uint32 ops    = 0;
+    Sint32 allocs;
+    Sint32 index;
+
+    for (;;)
+    {
+        start   = SDL_GetPerformanceCounter();
+        ops     = function(rounds, core);
+        elapsed = get_elapsed_ns(start);
+
+        if (0 == ops || elapsed >= BENCH_SAMPLE_MS * 1000000 || rounds >= 0x100000)
+        {
+            break;
+        }
+        rounds *= 2;
+    }
+
+    if (0 == ops)
+    {
+        printf("  %-18s       n/a\n", name);
+        return;
+    }
+
+    allocs = get_allocation_count(core);
+
+    for (index = 0; index < BENCH_SAMPLES; index += 1)
+    {
+        start         = SDL_GetPerformanceCounter();
+        ops           = function(rounds, core);
+        sample[index] = get_elapsed_ns(start) / ops;
+    }
+
+    allocs = get_allocation_count(core) - allocs;
+    qsort(sample, BENCH_SAMPLES, sizeof(Uint64), compare_ns);
+
+    printf(
+        "  %-18s %9llu ns/op (median %9llu)  %3d.%02d allocs/op\n",
+        name,
+        (unsigned long long)sample[0],
+        (unsigned long long)sample[BENCH_SAMPLES / 2],
+        (int)(allocs / ((Sint32)ops * BENCH_SAMPLES)),
+        (int)(((Sint64)allocs * 100 / ((Sint64)ops * BENCH_SAMPLES)) % 100));
+}
+
+int main(int argc, char *argv[])
+{
+    const char* res_file = BENCH_RES_FILE;
+    ngine_t*    core     = NULL;
+    Sint32      index;
+
+    if (argc > 1)
+    {
+        res_file = argv[1];
+    }
+
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+
+    SDL_zero(files);
+    init_file_reader(res_file);
+    list_files(add_file, &files);
+    if (0 == files.count)
+    {
+        printf("No files found in %s.\n", res_file);
+        return 1;
+    }
+
+    if (NG_OK != ng_init(res_file, "ngine_microbench", &core))
+    {
+        printf("Could not initialise the engine.\n");
+        return 1;
+    }
+
+    init_properties();
+
+    printf("synthetic\n");
+    run_case("generate_hash",     run_hash,       core);
+    run_case("get_property",      run_property,   core);
+    run_case("render_text",       run_text,       core);
+    run_case("render_debug_text", run_debug_text, core);
+
+    printf("%s (%d files)\n", res_file, files.count);
+    run_case("size_of_file",      run_pfs_size,   core);
+    run_case("read_binary_file",  run_pfs_read,   core);
+    run_case("load_resource",     run_resource,   core);
+
+    for (index = 0; index < files.count; index += 1)
+    {
+        if (! is_map_file(files.name[index]))
+        {
+            continue;
+        }
+
+        printf("%s\n", files.name[index]);
+
+        if (NG_OK != ng_load_map(files.name[index], core))
+        {
+            printf("  could not be loaded\n");
+            continue;
+        }
+
+        run_case("get_map_property", run_map_property,  core);
+        run_case("get_tile_index",   run_tile_index,    core);
+        run_case("is_tile_animated", run_tile_animated, core);
+
+        ng_unload_map(core);
+    }
+
+    ng_free(core);
+
+    return 0;
+}
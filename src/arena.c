@@ -0,0 +1,115 @@
+/** @file arena.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Linear scratch allocators.  Memory is handed out by bumping an
+ *  offset and released all at once by resetting the arena, so that
+ *  transient allocations neither fragment the heap nor leak.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include "ngine.h"
+
+#define ARENA_ALIGNMENT 8
+
+status_t init_arena(Uint32 size, arena_t* arena, ngine_t* core)
+{
+    SDL_memset(arena, 0, sizeof(struct arena));
+    arena->core = core;
+
+    arena->buffer = (Uint8*)alloc_memory((size_t)size, MEM_SCRATCH, core);
+    if (! arena->buffer)
+    {
+        //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+        return NG_ERROR;
+    }
+    arena->size = size;
+
+    return NG_OK;
+}
+
+void free_arena(arena_t* arena)
+{
+    if (arena->core)
+    {
+        free_memory(arena->buffer, arena->core);
+    }
+    SDL_memset(arena, 0, sizeof(struct arena));
+}
+
+// Safe to call from several threads at once.  Returns NULL if the arena
+// is exhausted.
+void* alloc_arena(Uint32 size, arena_t* arena)
+{
+    Uint32 aligned = (size + (ARENA_ALIGNMENT - 1)) & ~(Uint32)(ARENA_ALIGNMENT - 1);
+    Uint32 offset;
+
+    if (! arena->buffer || aligned > arena->size)
+    {
+        return NULL;
+    }
+
+    // The offset only moves if the allocation fits, so that failed
+    // allocations do not use up the arena.
+    for (;;)
+    {
+        offset = (Uint32)SDL_AtomicGet(&arena->used);
+
+        if (offset > arena->size - aligned)
+        {
+            return NULL;
+        }
+
+        if (SDL_AtomicCAS(&arena->used, (int)offset, (int)(offset + aligned)))
+        {
+            break;
+        }
+    }
+
+    return arena->buffer + offset;
+}
+
+// Everything allocated from the arena is invalidated.  Must not be
+// called while other threads allocate from it.
+void reset_arena(arena_t* arena)
+{
+    Uint32 used = (Uint32)SDL_AtomicGet(&arena->used);
+
+    if (used > arena->high_water)
+    {
+        arena->high_water = SDL_min(used, arena->size);
+    }
+
+    SDL_AtomicSet(&arena->used, 0);
+}
+
+// Falls back to the heap if the arena is exhausted.
+void* alloc_scratch(Uint32 size, arena_t* arena)
+{
+    void* memory = alloc_arena(size, arena);
+
+    if (! memory)
+    {
+        memory = alloc_memory((size_t)size, MEM_SCRATCH, arena->core);
+    }
+
+    return memory;
+}
+
+// Only memory that did not come from the arena is actually released.
+void free_scratch(void* memory, arena_t* arena)
+{
+    Uint8* pos = (Uint8*)memory;
+
+    if (arena->buffer && pos >= arena->buffer && pos < arena->buffer + arena->size)
+    {
+        return;
+    }
+
+    free_memory(memory, arena->core);
+}
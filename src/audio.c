@@ -0,0 +1,640 @@
+/** @file audio.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Software audio mixer.  Music is streamed from the PFS one block at a
+ *  time into a ring buffer, which the audio callback consumes; sound
+ *  effects are short and decoded when the map is loaded.  Both are mixed
+ *  into a signed 16-bit mono stream with integer arithmetic only, since
+ *  the N-Gage has no FPU.  Samples are resampled by stepping through them
+ *  in 16.16 fixed point.
+ *
+ *  Only uncompressed WAV files (8 or 16-bit, mono or stereo) are
+ *  supported; for streamed music, all chunks preceding the sample data
+ *  must fit into the first NG_AUDIO_BLOCK bytes.
+ *
+ *  Map properties: music (file name), music_volume and sound_volume
+ *  (1 to 128, full volume by default) and sound_1, sound_2, ... (file
+ *  names of the sound effects, played with ng_play_sound()).
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include <stb_sprintf.h>
+#include "ngine.h"
+
+#define H_music        0x000000310ff58e86
+#define H_music_volume 0xd6f63be6c5125a9d
+#define H_sound_volume 0xdb0b4fa6055f7785
+
+#define RING_MASK (NG_AUDIO_RING - 1)
+
+static Uint16 read_le16(const Uint8* data)
+{
+    return (Uint16)(data[0] | (data[1] << 8));
+}
+
+static Uint32 read_le32(const Uint8* data)
+{
+    return (Uint32)data[0] | ((Uint32)data[1] << 8) | ((Uint32)data[2] << 16) | ((Uint32)data[3] << 24);
+}
+
+// Looks up the format and the sample data of a RIFF WAVE file.
+static status_t parse_wav(const Uint8* data, Uint32 size, wav_format_t* format, Uint32* data_offset, Uint32* data_size)
+{
+    Uint32   offset     = 12;
+    SDL_bool has_format = SDL_FALSE;
+
+    if (size < 12 || 0 != SDL_memcmp(data, "RIFF", 4) || 0 != SDL_memcmp(data + 8, "WAVE", 4))
+    {
+        return NG_WARNING;
+    }
+
+    while (offset + 8 <= size)
+    {
+        Uint32 chunk_size = read_le32(data + offset + 4);
+
+        if (0 == SDL_memcmp(data + offset, "fmt ", 4))
+        {
+            const Uint8* chunk = data + offset + 8;
+
+            // PCM only.
+            if (chunk_size < 16 || offset + 8 + 16 > size || 1 != read_le16(chunk))
+            {
+                return NG_WARNING;
+            }
+
+            format->channels   = read_le16(chunk + 2);
+            format->rate       = read_le32(chunk + 4);
+            format->bits       = read_le16(chunk + 14);
+            format->frame_size = (Uint16)(format->channels * (format->bits / 8));
+
+            if ((1 != format->channels && 2 != format->channels) || (8 != format->bits && 16 != format->bits) ||
+                0 == format->rate || format->rate > 48000)
+            {
+                return NG_WARNING;
+            }
+            has_format = SDL_TRUE;
+        }
+        else if (0 == SDL_memcmp(data + offset, "data", 4))
+        {
+            if (! has_format)
+            {
+                return NG_WARNING;
+            }
+
+            *data_offset = offset + 8;
+            *data_size   = chunk_size;
+            return NG_OK;
+        }
+
+        if (chunk_size >= size)
+        {
+            return NG_WARNING;
+        }
+
+        // Chunks are padded to an even size.
+        offset += 8 + chunk_size + (chunk_size & 1);
+    }
+
+    return NG_WARNING;
+}
+
+// One frame of the file as a signed 16-bit mono sample.
+static Sint16 read_frame(const Uint8* frame, const wav_format_t* format)
+{
+    Sint32 left;
+    Sint32 right;
+
+    if (8 == format->bits)
+    {
+        left  = ((Sint32)frame[0] - 128) << 8;
+        right = (2 == format->channels) ? ((Sint32)frame[1] - 128) << 8 : left;
+    }
+    else
+    {
+        left  = (Sint16)read_le16(frame);
+        right = (2 == format->channels) ? (Sint16)read_le16(frame + 2) : left;
+    }
+
+    return (Sint16)((left + right) >> 1);
+}
+
+static Uint32 get_step(Uint32 rate, audio_t* audio)
+{
+    return (rate << FX_SHIFT) / (Uint32)audio->rate;
+}
+
+static void mix_music(Sint32* mix, Sint32 count, audio_t* audio)
+{
+    music_t* music = &audio->music;
+    Uint32   read  = (Uint32)SDL_AtomicGet(&music->read_pos);
+    Uint32   avail = (Uint32)SDL_AtomicGet(&music->write_pos) - read;
+    Sint32   index;
+
+    for (index = 0; index < count; index += 1)
+    {
+        Uint32 advance;
+
+        // The streamer did not keep up: the rest is silence.
+        if (0 == avail)
+        {
+            audio->underrun_count += 1;
+            break;
+        }
+
+        mix[index] += (music->ring[read & RING_MASK] * music->volume) >> 7;
+
+        music->frac += music->step;
+        advance      = SDL_min(music->frac >> FX_SHIFT, avail);
+        music->frac &= FX_FRAC_MASK;
+        read        += advance;
+        avail       -= advance;
+    }
+
+    SDL_AtomicSet(&music->read_pos, (int)read);
+}
+
+static void mix_voice(Sint32* mix, Sint32 count, voice_t* voice)
+{
+    const sound_t* sound = voice->sound;
+    Sint32         index;
+
+    for (index = 0; index < count; index += 1)
+    {
+        if (voice->index >= sound->length)
+        {
+            voice->sound = NULL;
+            return;
+        }
+
+        mix[index] += (sound->sample[voice->index] * voice->volume) >> 7;
+
+        voice->frac  += sound->step;
+        voice->index += (Sint32)(voice->frac >> FX_SHIFT);
+        voice->frac  &= FX_FRAC_MASK;
+    }
+}
+
+// Runs on the audio thread with the device locked.
+static void SDLCALL mix_audio(void* userdata, Uint8* stream, int len)
+{
+    audio_t* audio  = &((ngine_t*)userdata)->audio;
+    Sint16*  output = (Sint16*)stream;
+    Sint32   left   = len / (Sint32)sizeof(Sint16);
+    Sint32   mix[NG_AUDIO_SAMPLES];
+
+    while (left > 0)
+    {
+        Sint32 count = SDL_min(left, NG_AUDIO_SAMPLES);
+        Sint32 index;
+
+        SDL_memset(mix, 0, (size_t)count * sizeof(Sint32));
+
+        if (audio->music.is_playing)
+        {
+            mix_music(mix, count, audio);
+        }
+
+        for (index = 0; index < NG_AUDIO_VOICES; index += 1)
+        {
+            if (audio->voice[index].sound)
+            {
+                mix_voice(mix, count, &audio->voice[index]);
+            }
+        }
+
+        for (index = 0; index < count; index += 1)
+        {
+            output[index] = (Sint16)SDL_clamp(mix[index], -32768, 32767);
+        }
+
+        output += count;
+        left   -= count;
+    }
+}
+
+// Opens the music file and reads its first block.
+static status_t open_music(music_t* music)
+{
+    Uint32 file_size;
+    Uint32 data_offset;
+    Uint32 data_size;
+
+    music->file = open_binary_file_from_path(music->file_name);
+    if (! music->file)
+    {
+        //SDL_Log("Could not open %s.", music->file_name);
+        return NG_WARNING;
+    }
+
+    file_size        = (Uint32)size_of_file(music->file_name);
+    music->block_len = (Sint32)read_binary_chunk(music->file, music->block, SDL_min(file_size, NG_AUDIO_BLOCK));
+
+    if (NG_OK != parse_wav(music->block, (Uint32)music->block_len, &music->format, &data_offset, &data_size) || 0 == data_size)
+    {
+        //SDL_Log("%s is not a supported WAV file.", music->file_name);
+        close_binary_file(music->file);
+        music->file = NULL;
+        return NG_WARNING;
+    }
+
+    // The data chunk may end within the first block.
+    music->block_pos = (Sint32)data_offset;
+    music->block_len = (Sint32)SDL_min((Uint32)music->block_len, data_offset + data_size);
+    music->data_left = SDL_min(data_size - (Uint32)(music->block_len - music->block_pos), file_size - (Uint32)music->block_len);
+
+    return NG_OK;
+}
+
+static void close_music(music_t* music)
+{
+    if (music->file)
+    {
+        close_binary_file(music->file);
+        music->file = NULL;
+    }
+}
+
+// Keeps the partial frame at the end of the block.
+static void read_music_block(music_t* music)
+{
+    Sint32 remaining = music->block_len - music->block_pos;
+    Uint32 size      = SDL_min(music->data_left, (Uint32)(NG_AUDIO_BLOCK - remaining));
+    Uint32 read;
+
+    SDL_memmove(music->block, music->block + music->block_pos, (size_t)remaining);
+
+    read              = (Uint32)read_binary_chunk(music->file, music->block + remaining, size);
+    music->data_left  = (read < size) ? 0 : music->data_left - size;
+    music->block_pos  = 0;
+    music->block_len  = remaining + (Sint32)read;
+}
+
+// Tops up the ring buffer; music loops.  Reads at most the free space of
+// the ring buffer, so the time spent here is bounded.
+static status_t stream_music(music_t* music)
+{
+    Uint32 write = (Uint32)SDL_AtomicGet(&music->write_pos);
+    Uint32 space = NG_AUDIO_RING - (write - (Uint32)SDL_AtomicGet(&music->read_pos));
+
+    while (space > 0)
+    {
+        if (music->block_len - music->block_pos < music->format.frame_size)
+        {
+            if (music->data_left > 0)
+            {
+                read_music_block(music);
+            }
+            else
+            {
+                close_music(music);
+                if (NG_OK != open_music(music))
+                {
+                    SDL_AtomicSet(&music->write_pos, (int)write);
+                    return NG_WARNING;
+                }
+            }
+
+            // Truncated file.
+            if (music->block_len - music->block_pos < music->format.frame_size)
+            {
+                music->data_left = 0;
+                break;
+            }
+            continue;
+        }
+
+        music->ring[write & RING_MASK] = read_frame(music->block + music->block_pos, &music->format);
+
+        music->block_pos += music->format.frame_size;
+        write            += 1;
+        space            -= 1;
+    }
+
+    SDL_AtomicSet(&music->write_pos, (int)write);
+    return NG_OK;
+}
+
+static status_t load_sound(const char* file_name, sound_t* sound, ngine_t* core)
+{
+    wav_format_t format;
+    Uint8*       data;
+    Uint32       size;
+    Uint32       data_offset;
+    Uint32       data_size;
+    Sint32       index;
+
+    data = load_resource(file_name, &size, core);
+    if (! data)
+    {
+        //SDL_Log("Failed to load resource: %s", file_name);
+        return NG_WARNING;
+    }
+
+    if (NG_OK != parse_wav(data, size, &format, &data_offset, &data_size) || data_offset > size)
+    {
+        //SDL_Log("%s is not a supported WAV file.", file_name);
+        free_scratch(data, &core->load_arena);
+        return NG_WARNING;
+    }
+
+    sound->length = (Sint32)(SDL_min(data_size, size - data_offset) / format.frame_size);
+    sound->step   = get_step(format.rate, &core->audio);
+    sound->sample = (Sint16*)alloc_memory((size_t)sound->length * sizeof(Sint16), MEM_AUDIO, core);
+    if (! sound->sample)
+    {
+        //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+        free_scratch(data, &core->load_arena);
+        return NG_WARNING;
+    }
+
+    for (index = 0; index < sound->length; index += 1)
+    {
+        sound->sample[index] = read_frame(data + data_offset + (Uint32)index * format.frame_size, &format);
+    }
+
+    free_scratch(data, &core->load_arena);
+    return NG_OK;
+}
+
+// Without an audio device, the engine runs silently.
+status_t init_audio(ngine_t* core)
+{
+    audio_t*      audio = &core->audio;
+    SDL_AudioSpec want;
+    SDL_AudioSpec have;
+
+    SDL_zero(want);
+    want.freq     = NG_AUDIO_RATE;
+    want.format   = AUDIO_S16SYS;
+    want.channels = 1;
+    want.samples  = NG_AUDIO_SAMPLES;
+    want.callback = mix_audio;
+    want.userdata = core;
+
+    audio->sound_volume = NG_AUDIO_VOLUME;
+    audio->music.volume = NG_AUDIO_VOLUME;
+
+    if (0 != SDL_InitSubSystem(SDL_INIT_AUDIO))
+    {
+        //SDL_Log("Unable to initialise audio: %s", SDL_GetError());
+        return NG_WARNING;
+    }
+
+    // SDL converts to the format of the device, if need be.
+    audio->device = SDL_OpenAudioDevice(NULL, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    if (0 == audio->device)
+    {
+        //SDL_Log("Could not open audio device: %s", SDL_GetError());
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return NG_WARNING;
+    }
+    audio->rate = have.freq;
+
+    SDL_PauseAudioDevice(audio->device, 0);
+
+    return NG_OK;
+}
+
+void free_audio(ngine_t* core)
+{
+    audio_t* audio = &core->audio;
+
+    if (0 == audio->device)
+    {
+        return;
+    }
+
+    SDL_CloseAudioDevice(audio->device);
+    audio->device = 0;
+    close_music(&audio->music);
+
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
+
+// Called once per frame.
+void update_audio(ngine_t* core)
+{
+    music_t* music = &core->audio.music;
+
+    if (! music->is_playing)
+    {
+        return;
+    }
+
+    if (NG_OK != stream_music(music))
+    {
+        ng_stop_music(core);
+    }
+}
+
+// [12] Sound effects and music of the map.  The music keeps playing
+// through a map change if both maps use the same file.
+status_t load_map_audio(ngine_t* core)
+{
+    audio_t* audio             = &core->audio;
+    char     property_name[17] = { 0 };
+    Sint32   prop_cnt          = core->map->handle->property_count;
+    Sint32   music_volume      = get_integer_map_property(H_music_volume, core);
+    Sint32   sound_volume      = get_integer_map_property(H_sound_volume, core);
+    status_t status            = NG_OK;
+    Sint32   index;
+
+    if (0 == audio->device)
+    {
+        return NG_OK;
+    }
+
+    SDL_LockAudioDevice(audio->device);
+    audio->music.volume = (music_volume > 0) ? SDL_min(music_volume, NG_AUDIO_VOLUME) : NG_AUDIO_VOLUME;
+    audio->sound_volume = (sound_volume > 0) ? SDL_min(sound_volume, NG_AUDIO_VOLUME) : NG_AUDIO_VOLUME;
+    SDL_UnlockAudioDevice(audio->device);
+
+    core->map->sound_count = 0;
+
+    for (;;)
+    {
+        stbsp_snprintf(property_name, 17, "sound_%u", core->map->sound_count + 1);
+
+        if (! get_string_property(generate_hash((const unsigned char*)property_name), core->map->handle->properties, prop_cnt, core))
+        {
+            break;
+        }
+        core->map->sound_count += 1;
+    }
+
+    if (core->map->sound_count > 0)
+    {
+        core->map->sound = (sound_t*)calloc_memory((size_t)core->map->sound_count, sizeof(struct sound), MEM_AUDIO, core);
+        if (! core->map->sound)
+        {
+            //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+            core->map->sound_count = 0;
+            status = NG_WARNING;
+        }
+    }
+
+    for (index = 0; index < core->map->sound_count; index += 1)
+    {
+        stbsp_snprintf(property_name, 17, "sound_%u", index + 1);
+
+        // A sound that fails to load stays silent.
+        if (NG_OK != load_sound(get_string_property(generate_hash((const unsigned char*)property_name), core->map->handle->properties, prop_cnt, core), &core->map->sound[index], core))
+        {
+            status = NG_WARNING;
+        }
+    }
+
+    if (NG_OK != ng_play_music(get_string_map_property(H_music, core), core))
+    {
+        status = NG_WARNING;
+    }
+
+    return status;
+}
+
+void free_map_audio(ngine_t* core)
+{
+    audio_t* audio = &core->audio;
+    Sint32   index;
+
+    if (! core->map->sound)
+    {
+        return;
+    }
+
+    // Voices refer to the sounds of the map.
+    if (audio->device)
+    {
+        SDL_LockAudioDevice(audio->device);
+        for (index = 0; index < NG_AUDIO_VOICES; index += 1)
+        {
+            audio->voice[index].sound = NULL;
+        }
+        SDL_UnlockAudioDevice(audio->device);
+    }
+
+    for (index = 0; index < core->map->sound_count; index += 1)
+    {
+        free_memory(core->map->sound[index].sample, core);
+    }
+
+    free_memory(core->map->sound, core);
+    core->map->sound       = NULL;
+    core->map->sound_count = 0;
+}
+
+// Streams a WAV file from the PFS in a loop.  NULL stops the music; the
+// music already playing continues if it is the same file.
+status_t ng_play_music(const char* file_name, ngine_t* core)
+{
+    audio_t* audio = &core->audio;
+    music_t* music = &audio->music;
+
+    if (! file_name)
+    {
+        ng_stop_music(core);
+        return NG_OK;
+    }
+
+    if (0 == audio->device)
+    {
+        return NG_WARNING;
+    }
+
+    if (music->is_playing && 0 == SDL_strcmp(music->file_name, file_name))
+    {
+        return NG_OK;
+    }
+
+    ng_stop_music(core);
+
+    SDL_strlcpy(music->file_name, file_name, NG_AUDIO_NAME_SIZE);
+    if (NG_OK != open_music(music))
+    {
+        music->file_name[0] = '\0';
+        return NG_WARNING;
+    }
+
+    music->step = get_step(music->format.rate, audio);
+
+    // Fill the ring buffer before the callback gets to see it.
+    if (NG_OK != stream_music(music))
+    {
+        ng_stop_music(core);
+        return NG_WARNING;
+    }
+
+    SDL_LockAudioDevice(audio->device);
+    music->is_playing = SDL_TRUE;
+    SDL_UnlockAudioDevice(audio->device);
+
+    return NG_OK;
+}
+
+void ng_stop_music(ngine_t* core)
+{
+    audio_t* audio = &core->audio;
+    music_t* music = &audio->music;
+
+    if (0 == audio->device)
+    {
+        return;
+    }
+
+    SDL_LockAudioDevice(audio->device);
+    music->is_playing = SDL_FALSE;
+    SDL_UnlockAudioDevice(audio->device);
+
+    close_music(music);
+    music->file_name[0] = '\0';
+    music->frac         = 0;
+    SDL_AtomicSet(&music->read_pos,  0);
+    SDL_AtomicSet(&music->write_pos, 0);
+}
+
+// Plays sound_<id> of the current map at a volume of 0 to 128.  If all
+// voices are busy, the one following the voice started last is
+// replaced.  Returns the voice or -1.
+Sint32 ng_play_sound(Sint32 id, Sint32 volume, ngine_t* core)
+{
+    audio_t* audio = &core->audio;
+    Sint32   slot  = -1;
+    Sint32   index;
+
+    if (0 == audio->device || ! core->map || id < 1 || id > core->map->sound_count || ! core->map->sound[id - 1].sample)
+    {
+        return -1;
+    }
+
+    SDL_LockAudioDevice(audio->device);
+
+    for (index = 0; index < NG_AUDIO_VOICES; index += 1)
+    {
+        if (! audio->voice[index].sound)
+        {
+            slot = index;
+            break;
+        }
+    }
+
+    if (0 > slot)
+    {
+        slot = audio->next_voice;
+    }
+    audio->next_voice = (slot + 1) % NG_AUDIO_VOICES;
+
+    audio->voice[slot].sound  = &core->map->sound[id - 1];
+    audio->voice[slot].index  = 0;
+    audio->voice[slot].frac   = 0;
+    audio->voice[slot].volume = (SDL_clamp(volume, 0, NG_AUDIO_VOLUME) * audio->sound_volume) / NG_AUDIO_VOLUME;
+
+    SDL_UnlockAudioDevice(audio->device);
+
+    return slot;
+}
@@ -0,0 +1,141 @@
+/** @file collision.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Swept AABB collision against the tile grid and between entities.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include "ngine.h"
+
+aabb_t get_entity_aabb(Sint32 index, ngine_t* core)
+{
+    entity_body_t* body = &core->map->entity.body[index];
+    aabb_t         bb;
+
+    bb.left   = core->map->entity.pos_x[index] - (body->width  / 2);
+    bb.top    = core->map->entity.pos_y[index] - (body->height / 2);
+    bb.right  = bb.left + body->width  - 1;
+    bb.bottom = bb.top  + body->height - 1;
+
+    return bb;
+}
+
+// Returns how far the entity can move along the x axis before its
+// bounding box touches a solid tile.  Only the columns entered by the
+// leading edge are tested, so entities that already overlap a solid
+// tile are able to move out of it.
+Sint32 sweep_entity_x(Sint32 index, Sint32 offset_x, ngine_t* core)
+{
+    aabb_t bb        = get_entity_aabb(index, core);
+    Sint32 tile_w    = get_tile_width(core->map->handle);
+    Sint32 tile_h    = get_tile_height(core->map->handle);
+    Sint32 first_row = floor_div(bb.top,    tile_h);
+    Sint32 last_row  = floor_div(bb.bottom, tile_h);
+    Sint32 col;
+
+    if (offset_x > 0)
+    {
+        Sint32 last_col = floor_div(bb.right + offset_x, tile_w);
+
+        for (col = floor_div(bb.right, tile_w) + 1; col <= last_col; col += 1)
+        {
+            if (is_rect_attr_set(TA_SOLID, col, first_row, col, last_row, core))
+            {
+                return SDL_max(0, (col * tile_w) - 1 - bb.right);
+            }
+        }
+    }
+    else if (offset_x < 0)
+    {
+        Sint32 last_col = floor_div(bb.left + offset_x, tile_w);
+
+        for (col = floor_div(bb.left, tile_w) - 1; col >= last_col; col -= 1)
+        {
+            if (is_rect_attr_set(TA_SOLID, col, first_row, col, last_row, core))
+            {
+                return SDL_min(0, ((col + 1) * tile_w) - bb.left);
+            }
+        }
+    }
+
+    return offset_x;
+}
+
+Sint32 sweep_entity_y(Sint32 index, Sint32 offset_y, ngine_t* core)
+{
+    aabb_t bb        = get_entity_aabb(index, core);
+    Sint32 tile_w    = get_tile_width(core->map->handle);
+    Sint32 tile_h    = get_tile_height(core->map->handle);
+    Sint32 first_col = floor_div(bb.left,  tile_w);
+    Sint32 last_col  = floor_div(bb.right, tile_w);
+    Sint32 row;
+
+    if (offset_y > 0)
+    {
+        Sint32 last_row = floor_div(bb.bottom + offset_y, tile_h);
+
+        // One-way tiles can only be entered from above.
+        for (row = floor_div(bb.bottom, tile_h) + 1; row <= last_row; row += 1)
+        {
+            if (is_row_attr_set(TA_SOLID, row, first_col, last_col, core) || is_row_attr_set(TA_ONE_WAY, row, first_col, last_col, core))
+            {
+                return SDL_max(0, (row * tile_h) - 1 - bb.bottom);
+            }
+        }
+    }
+    else if (offset_y < 0)
+    {
+        Sint32 last_row = floor_div(bb.top + offset_y, tile_h);
+
+        for (row = floor_div(bb.top, tile_h) - 1; row >= last_row; row -= 1)
+        {
+            if (is_row_attr_set(TA_SOLID, row, first_col, last_col, core))
+            {
+                return SDL_min(0, ((row + 1) * tile_h) - bb.top);
+            }
+        }
+    }
+
+    return offset_y;
+}
+
+SDL_bool do_entities_overlap(Sint32 index_a, Sint32 index_b, ngine_t* core)
+{
+    return bb_do_intersect(get_entity_aabb(index_a, core), get_entity_aabb(index_b, core));
+}
+
+// Collects all entities whose bounding box overlaps the one of the given
+// entity.  Candidates are taken from the spatial grid.
+Sint32 get_overlapping_entities(Sint32 index, Sint32* result, Sint32 max_results, ngine_t* core)
+{
+    aabb_t bb    = get_entity_aabb(index, core);
+    Sint32 count;
+    Sint32 pos;
+    Sint32 hits  = 0;
+
+    count = query_grid_rect(
+        bb.left,
+        bb.top,
+        (bb.right  - bb.left) + 1,
+        (bb.bottom - bb.top)  + 1,
+        result,
+        max_results,
+        core);
+
+    for (pos = 0; pos < count; pos += 1)
+    {
+        if (result[pos] != index && do_entities_overlap(index, result[pos], core))
+        {
+            result[hits]  = result[pos];
+            hits         += 1;
+        }
+    }
+
+    return hits;
+}
@@ -24,6 +24,11 @@
 #define STRPOOL_EMBEDDED_STRNICMP strncasecmp
 #endif
 
+// The map is passed as memory context, so that cute_tiled is accounted
+// for by the tracking allocator.
+#define CUTE_TILED_ALLOC(size, ctx) alloc_memory((size_t)(size), MEM_TILED, (ngine_t*)(ctx))
+#define CUTE_TILED_FREE(mem, ctx)   free_memory((mem), (ngine_t*)(ctx))
+
 #define CUTE_TILED_IMPLEMENTATION
 #include <cute_tiled.h>
 
@@ -45,10 +50,19 @@
 #define H_anim_walk_right_len   0xaa54d94ac5a4dab3
 #define H_anim_walk_up_index    0x6a0292585ea2eb33
 #define H_anim_walk_up_len      0x538cd069ddc403da
+#define H_behaviour             0x0377c2c7f038a42a
 #define H_display_text          0xd064eba5e9b9b1df
+#define H_follow_player         0x0f5c157c30772a64
 #define H_height                0x0000065301d688de
+#define H_hitbox_height         0x399ba9cd851b070b
+#define H_hitbox_width          0xd3334334c70a9d32
+#define H_is_damaging           0xc09beecb233d4b78
+#define H_is_one_way            0x727154d346c9bfb2
 #define H_is_player             0x0377cc4478b16e8d
 #define H_is_solid              0x001ae728dd16b21b
+#define H_is_trigger            0x727154d4d14e1374
+#define H_is_water              0x001ae728dd578863
+#define H_jump_height           0xc0a1c68c7d3e7879
 #define H_map_down              0x001ae74b4abd8f1a
 #define H_map_left              0x001ae74b4ac1c56d
 #define H_map_right             0x0377d0b4a3693ac0
@@ -57,11 +71,16 @@
 #define H_sprite_cols           0xc0d1f24f33052c2c
 #define H_sprite_id             0x0377d8f6e7994748
 #define H_tilelayer             0x0377d9f70e844fb0
+#define H_update_rate           0xc0dcc2047ce9c0b3
+#define H_wander                0x00000653248e3906
 #define H_width                 0x0000003110a3b0a5
-// Could be fun if the engine supports platformer games.
+// Platformer mode.
 #define H_meter_in_pixel        0xfbbc8a6d4a407cf9
 #define H_gravity               0x0000d0b30d77f26b
 
+// Entity pool.
+#define H_entity_capacity       0x9b637c81aa98066f
+
 Sint32 get_first_gid(cute_tiled_map_t* tiled_map)
 {
     return tiled_map->tilesets->firstgid;
@@ -272,65 +291,39 @@ Uint64 generate_hash(const unsigned char* name)
     return hash;
 }
 
-void load_property(const Uint64 name_hash, cute_tiled_property_t* properties, Sint32 property_count, ngine_t* core)
+// Pure lookup without side effects, so that properties can be read
+// from several threads at once.
+static const cute_tiled_property_t* find_property(const Uint64 name_hash, CUTE_TILED_PROPERTY_TYPE type, cute_tiled_property_t* properties, Sint32 property_count)
 {
-    int      index      = 0;
-    SDL_bool prop_found = SDL_FALSE;
+    Sint32 index;
 
+    // Entities are allowed to have no properties.
     for (index = 0; index < property_count; index += 1)
     {
-        if (name_hash == generate_hash((const unsigned char*)properties[index].name.ptr))
+        if (! properties[index].name.ptr)
         {
-            prop_found = SDL_TRUE;
-            break;
+            continue;
         }
-    }
-
-    if (! prop_found)
-    {
-        return;
-    }
-
-    // Entities are allowed to have no properties.
-    if (0 == property_count)
-    {
-        return;
-    }
 
-    if (properties[index].name.ptr)
-    {
-        switch (properties[index].type)
+        if (name_hash == generate_hash((const unsigned char*)properties[index].name.ptr))
         {
-            case CUTE_TILED_PROPERTY_COLOR:
-            case CUTE_TILED_PROPERTY_FILE:
-            case CUTE_TILED_PROPERTY_NONE:
-                break;
-            case CUTE_TILED_PROPERTY_INT:
-                core->map->integer_property = properties[index].data.integer;
-                break;
-            case CUTE_TILED_PROPERTY_BOOL:
-                core->map->boolean_property = (SDL_bool)properties[index].data.boolean;
-                break;
-            case CUTE_TILED_PROPERTY_FLOAT:
-                core->map->decimal_property = (float)properties[index].data.floating;
-                break;
-            case CUTE_TILED_PROPERTY_STRING:
-                core->map->string_property  = properties[index].data.string.ptr;
-                break;
+            return (type == properties[index].type) ? &properties[index] : NULL;
         }
     }
+
+    return NULL;
 }
 
 status_t create_and_set_render_target(SDL_Texture** target, ngine_t* core)
 {
     if (! (*target))
     {
-        (*target) = SDL_CreateTexture(
-            core->renderer,
+        (*target) = create_texture(
             SDL_PIXELFORMAT_RGB444,
             SDL_TEXTUREACCESS_TARGET,
             176,
-            208);
+            208,
+            core);
     }
 
     if (! (*target))
@@ -342,11 +335,41 @@ status_t create_and_set_render_target(SDL_Texture** target, ngine_t* core)
     if (0 > SDL_SetRenderTarget(core->renderer, (*target)))
     {
         //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
-        SDL_DestroyTexture((*target));
+        destroy_texture(target, core);
         return NG_ERROR;
     }
 
     SDL_RenderClear(core->renderer);
+    count_draw(NULL, NULL, core);
+
+    return NG_OK;
+}
+
+status_t set_frame_target(ngine_t* core)
+{
+    // The intermediate render target is only required for
+    // post-processing.  Otherwise, the scene is composed directly into
+    // the backbuffer, which saves a full-screen copy and a clear per
+    // frame.
+    if (core->use_render_target)
+    {
+        return create_and_set_render_target(&core->render_target, core);
+    }
+
+    if (0 > SDL_SetRenderTarget(core->renderer, NULL))
+    {
+        //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
+        return NG_ERROR;
+    }
+
+    // Maps smaller than the viewport do not cover the entire
+    // backbuffer.
+    if (core->map->width < 176 || core->map->height < 208)
+    {
+        SDL_SetRenderDrawColor(core->renderer, 0x00, 0x00, 0x00, 0x00);
+        SDL_RenderClear(core->renderer);
+        count_draw(NULL, NULL, core);
+    }
 
     return NG_OK;
 }
@@ -358,9 +381,9 @@ Sint32 get_tile_index(Sint32 pos_x, Sint32 pos_y, ngine_t* core)
     tile_index  = pos_x  / get_tile_width(core->map->handle);
     tile_index += (pos_y / get_tile_height(core->map->handle)) * core->map->handle->width;
 
-    if (tile_index > (core->map->tile_desc_count - 1))
+    if (tile_index > (core->map->tile_count - 1))
     {
-        tile_index = core->map->tile_desc_count - 1;
+        tile_index = core->map->tile_count - 1;
     }
 
     return tile_index;
@@ -394,96 +417,80 @@ int get_tile_height(cute_tiled_map_t* tiled_map)
 
 SDL_bool get_boolean_map_property(const Uint64 name_hash, ngine_t* core)
 {
-    Sint32 prop_cnt;
-
     if (! is_map_loaded(core))
     {
         return SDL_FALSE;
     }
 
-    prop_cnt                    = get_map_property_count(core->map->handle);
-    core->map->boolean_property = SDL_FALSE;
-    load_property(name_hash, core->map->handle->properties, prop_cnt, core);
-    return core->map->boolean_property;
+    return get_boolean_property(name_hash, core->map->handle->properties, get_map_property_count(core->map->handle), core);
 }
 
 float get_decimal_map_property(const Uint64 name_hash, ngine_t* core)
 {
-    Sint32 prop_cnt;
-
     if (! is_map_loaded(core))
     {
         return 0.0;
     }
 
-    prop_cnt                    = get_map_property_count(core->map->handle);
-    core->map->decimal_property = 0.0;
-    load_property(name_hash, core->map->handle->properties, prop_cnt, core);
-    return core->map->decimal_property;
+    return get_decimal_property(name_hash, core->map->handle->properties, get_map_property_count(core->map->handle), core);
 }
 
 Sint32 get_integer_map_property(const Uint64 name_hash, ngine_t* core)
 {
-    Sint32 prop_cnt;
-
     if (! is_map_loaded(core))
     {
         return 0;
     }
 
-    prop_cnt                    = get_map_property_count(core->map->handle);
-    core->map->integer_property = 0;
-    load_property(name_hash, core->map->handle->properties, prop_cnt, core);
-    return core->map->integer_property;
+    return get_integer_property(name_hash, core->map->handle->properties, get_map_property_count(core->map->handle), core);
 }
 
 const char* get_string_map_property(const Uint64 name_hash, ngine_t* core)
 {
-    Sint32 prop_cnt;
-
     if (! is_map_loaded(core))
     {
         return NULL;
     }
 
-    prop_cnt                   = get_map_property_count(core->map->handle);
-    core->map->string_property = NULL;
-    load_property(name_hash, core->map->handle->properties, prop_cnt, core);
-    return core->map->string_property;
+    return get_string_property(name_hash, core->map->handle->properties, get_map_property_count(core->map->handle), core);
 }
 
 SDL_bool get_boolean_property(const Uint64 name_hash, cute_tiled_property_t* properties, Sint32 property_count, ngine_t* core)
 {
-    core->map->boolean_property = SDL_FALSE;
-    load_property(name_hash, properties, property_count, core);
-    return core->map->boolean_property;
+    const cute_tiled_property_t* property = find_property(name_hash, CUTE_TILED_PROPERTY_BOOL, properties, property_count);
+
+    (void)core;
+    return property ? (SDL_bool)property->data.boolean : SDL_FALSE;
 }
 
 float get_decimal_property(const Uint64 name_hash, cute_tiled_property_t* properties, Sint32 property_count, ngine_t* core)
 {
-    core->map->decimal_property = 0.0;
-    load_property(name_hash, properties, property_count, core);
-    return core->map->decimal_property;
+    const cute_tiled_property_t* property = find_property(name_hash, CUTE_TILED_PROPERTY_FLOAT, properties, property_count);
+
+    (void)core;
+    return property ? (float)property->data.floating : 0.0;
 }
 
-int32_t get_integer_property(const Uint64 name_hash, cute_tiled_property_t* properties, Sint32 property_count, ngine_t* core)
+Sint32 get_integer_property(const Uint64 name_hash, cute_tiled_property_t* properties, Sint32 property_count, ngine_t* core)
 {
-    core->map->integer_property = 0;
-    load_property(name_hash, properties, property_count, core);
-    return core->map->integer_property;
+    const cute_tiled_property_t* property = find_property(name_hash, CUTE_TILED_PROPERTY_INT, properties, property_count);
+
+    (void)core;
+    return property ? property->data.integer : 0;
 }
 
 const char* get_string_property(const Uint64 name_hash, cute_tiled_property_t* properties, Sint32 property_count, ngine_t* core)
 {
-    core->map->string_property = NULL;
-    load_property(name_hash, properties, property_count, core);
-    return core->map->string_property;
+    const cute_tiled_property_t* property = find_property(name_hash, CUTE_TILED_PROPERTY_STRING, properties, property_count);
+
+    (void)core;
+    return property ? property->data.string.ptr : NULL;
 }
 
 void trigger_action(ngine_t* core)
 {
-    cute_tiled_layer_t*  layer;
-    cute_tiled_object_t* tiled_object = NULL;
+    const trigger_t* trigger;
+    Sint32           player;
 
     if (! is_map_loaded(core))
     {
@@ -491,37 +498,29 @@ void trigger_action(ngine_t* core)
         return;
     }
 
-    layer = get_head_layer(core->map->handle);
+    if (! core->map->entity_count || ! core->map->active_entity)
+    {
+        return;
+    }
+
+    player  = get_entity_index(core->map->active_entity, core);
+    trigger = find_trigger(
+        floor_div(core->map->entity.pos_x[player], get_tile_width(core->map->handle)),
+        floor_div(core->map->entity.pos_y[player], get_tile_height(core->map->handle)),
+        core);
 
-    while (layer && core->map->entity_count)
+    if (! trigger || trigger->entity == player)
     {
-        if (is_tiled_layer_of_type(OBJECT_GROUP, layer, core))
-        {
-            Sint32 index = 0;
-            tiled_object = get_head_object(layer, core);
-            while (tiled_object)
-            {
-                cute_tiled_property_t* properties   = tiled_object->properties;
-                Sint32                 prop_cnt     = get_object_property_count(tiled_object);
-                entity_t*              entity_a     = &core->map->entity[index];
-                entity_t*              entity_b     = &core->map->entity[core->map->active_entity - 1];
-                Sint32                 tile_index_a = get_tile_index(entity_a->pos_x, entity_a->pos_y, core);
-                Sint32                 tile_index_b = get_tile_index(entity_b->pos_x, entity_b->pos_y, core);
-
-                if (tile_index_a == tile_index_b)
-                {
-                    if (get_string_property(H_display_text, properties, prop_cnt, core))
-                    {
-                        set_display_text(core->map->string_property, core);
-                        break;
-                    }
-                }
+        return;
+    }
 
-                index        += 1;
-                tiled_object = tiled_object->next;
-            }
-        }
-        layer = layer->next;
+    switch (trigger->type)
+    {
+        case TRIGGER_DISPLAY_TEXT:
+            set_display_text(trigger->text, core);
+            break;
+        case TRIGGER_NONE:
+            break;
     }
 }
 
@@ -529,17 +528,15 @@ status_t load_tiles(ngine_t* core)
 {
     cute_tiled_layer_t* layer = get_head_layer(core->map->handle);
 
-    core->map->tile_desc_count = (Sint32)(core->map->handle->height * core->map->handle->width);
+    core->map->tile_count = (Sint32)(core->map->handle->height * core->map->handle->width);
 
-    if (core->map->tile_desc_count < 0)
+    if (core->map->tile_count < 0)
     {
         return NG_OK;
     }
 
-    core->map->tile_desc = (tile_desc_t*)calloc((size_t)core->map->tile_desc_count, sizeof(struct tile_desc));
-    if (! core->map->tile_desc)
+    if (NG_OK != alloc_tile_attr((Sint32)core->map->handle->width, (Sint32)core->map->handle->height, core))
     {
-        //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
         return NG_ERROR;
     }
 
@@ -559,13 +556,30 @@ status_t load_tiles(ngine_t* core)
                     Sint32                        tile_index    = (index_height * (Sint32)core->map->handle->width) + index_width;
                     Sint32                        gid           = remove_gid_flip_bits((Sint32)layer_content[tile_index]);
 
+                    // Attributes of all layers are combined.
                     if (tile_has_properties(gid, &tile, core->map->handle))
                     {
                         Sint32 prop_cnt = get_tile_property_count(tile);
 
                         if (get_boolean_property(H_is_solid, tile->properties, prop_cnt, core))
                         {
-                            core->map->tile_desc[tile_index].is_solid = SDL_TRUE;
+                            set_tile_attr(TA_SOLID, index_width, index_height, SDL_TRUE, core);
+                        }
+                        if (get_boolean_property(H_is_water, tile->properties, prop_cnt, core))
+                        {
+                            set_tile_attr(TA_WATER, index_width, index_height, SDL_TRUE, core);
+                        }
+                        if (get_boolean_property(H_is_damaging, tile->properties, prop_cnt, core))
+                        {
+                            set_tile_attr(TA_DAMAGING, index_width, index_height, SDL_TRUE, core);
+                        }
+                        if (get_boolean_property(H_is_trigger, tile->properties, prop_cnt, core))
+                        {
+                            set_tile_attr(TA_TRIGGER, index_width, index_height, SDL_TRUE, core);
+                        }
+                        if (get_boolean_property(H_is_one_way, tile->properties, prop_cnt, core))
+                        {
+                            set_tile_attr(TA_ONE_WAY, index_width, index_height, SDL_TRUE, core);
                         }
                     }
                 }
@@ -584,7 +598,8 @@ status_t load_tileset(ngine_t* core)
 
     stbsp_snprintf(tileset_file_name, 16, "%s", core->map->handle->tilesets->image.ptr);
 
-    if (NG_OK != load_texture_from_file((const char*)tileset_file_name, &core->map->tileset_texture, core))
+    // The texture is created by load_map_textures().
+    if (NG_OK != load_surface_from_file((const char*)tileset_file_name, &core->map->tileset_surface, core))
     {
         //SDL_Log("%s: Error loading image '%s'.", FUNCTION_NAME, tileset_file_name);
         status = NG_ERROR;
@@ -597,22 +612,23 @@ status_t load_tiled_map(const char* map_file_name, ngine_t* core)
 {
     cute_tiled_layer_t* layer;
     Uint8*              resource_buf;
+    Uint32              resource_size;
 
-    resource_buf = (Uint8*)load_binary_file_from_path(map_file_name);
+    resource_buf = load_resource(map_file_name, &resource_size, core);
     if (! resource_buf)
     {
         //SDL_Log("Failed to load resource: %s", map_file_name);
         return NG_ERROR;
     }
 
-    core->map->handle = cute_tiled_load_map_from_memory((const void*)resource_buf, size_of_file(map_file_name), NULL);
+    core->map->handle = cute_tiled_load_map_from_memory((const void*)resource_buf, (int)resource_size, core);
     if (! core->map->handle)
     {
-        free(resource_buf);
+        free_scratch(resource_buf, &core->load_arena);
         //SDL_Log("%s: %s.", FUNCTION_NAME, cute_tiled_error_reason);
         return NG_WARNING;
     }
-    free(resource_buf);
+    free_scratch(resource_buf, &core->load_arena);
 
     layer = get_head_layer(core->map->handle);
     while (layer)
@@ -667,7 +683,7 @@ status_t load_animated_tiles(ngine_t* core)
     }
     else
     {
-        core->map->animated_tile = (animated_tile_t*)calloc((size_t)animated_tile_count, sizeof(struct animated_tile));
+        core->map->animated_tile = (animated_tile_t*)calloc_memory((size_t)animated_tile_count, sizeof(struct animated_tile), MEM_MAP, core);
         if (! core->map->animated_tile)
         {
             //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
@@ -675,14 +691,50 @@ status_t load_animated_tiles(ngine_t* core)
         }
     }
 
+    // Register the animated tiles, so that they can be updated without
+    // touching the map data again.
+    layer = get_head_layer(core->map->handle);
+    while (layer)
+    {
+        if (is_tiled_layer_of_type(TILE_LAYER, layer, core) && layer->visible)
+        {
+            for (index_height = 0; index_height < (Sint32)core->map->handle->height; index_height += 1)
+            {
+                for (index_width = 0; index_width < (Sint32)core->map->handle->width; index_width += 1)
+                {
+                    Sint32*          layer_content    = get_layer_content(layer);
+                    Sint32           gid              = remove_gid_flip_bits((Sint32)layer_content[(index_height * (Sint32)core->map->handle->width) + index_width]);
+                    Sint32           animation_length = 0;
+                    Sint32           id               = 0;
+                    animated_tile_t* animated_tile;
+
+                    if (! is_tile_animated(gid, &animation_length, &id, core->map->handle))
+                    {
+                        continue;
+                    }
+
+                    animated_tile                   = &core->map->animated_tile[core->map->animated_tile_index];
+                    animated_tile->gid              = get_local_id(gid, core->map->handle);
+                    animated_tile->id               = id;
+                    animated_tile->dst_x            = index_width  * get_tile_width(core->map->handle);
+                    animated_tile->dst_y            = index_height * get_tile_height(core->map->handle);
+                    animated_tile->current_frame    = 0;
+                    animated_tile->animation_length = animation_length;
+
+                    core->map->animated_tile_index += 1;
+                }
+            }
+        }
+        layer = layer->next;
+    }
+
     //SDL_Log("Load %u animated tile(s).", animated_tile_count);
 
     return NG_OK;
 }
 
-status_t load_sprites(ngine_t* core)
+status_t alloc_sprites(ngine_t* core)
 {
-    status_t status            = NG_OK;
     char     property_name[17] = { 0 };
     SDL_bool search_is_running = SDL_TRUE;
     Sint32   prop_cnt          = get_map_property_count(core->map->handle);
@@ -709,7 +761,7 @@ status_t load_sprites(ngine_t* core)
         return NG_OK;
     }
 
-    core->map->sprite = (sprite_t*)calloc((size_t)core->map->sprite_count, sizeof(struct sprite));
+    core->map->sprite = (sprite_t*)calloc_memory((size_t)core->map->sprite_count, sizeof(struct sprite), MEM_MAP, core);
     if (! core->map->sprite)
     {
         //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
@@ -718,41 +770,137 @@ status_t load_sprites(ngine_t* core)
 
     for (index = 0; index < core->map->sprite_count; index += 1)
     {
-        const char* file_name;
         stbsp_snprintf(property_name, 17, "sprite_sheet_%u", index + 1);
 
-        file_name = get_string_property(generate_hash((const unsigned char*)property_name), core->map->handle->properties, prop_cnt, core);
+        core->map->sprite[index].id        = index + 1;
+        core->map->sprite[index].file_name = get_string_property(generate_hash((const unsigned char*)property_name), core->map->handle->properties, prop_cnt, core);
+    }
+
+    return NG_OK;
+}
+
+// Decodes the sprite sheets [first, first + count); the textures are
+// created by load_map_textures().
+status_t load_sprites(Sint32 first, Sint32 count, ngine_t* core)
+{
+    Sint32 index;
+
+    for (index = first; index < first + count && index < core->map->sprite_count; index += 1)
+    {
+        status_t status = load_surface_from_file(core->map->sprite[index].file_name, &core->map->sprite[index].surface, core);
 
-        if (file_name)
+        if (NG_OK != status)
         {
-            Sint32 source_length       = (Sint32)(strlen(file_name) + 1);
-            char*  sprite_image_source = (char*)calloc(1, source_length);
-            if (! sprite_image_source)
-            {
-                //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
-                return NG_ERROR;
-            }
+            return status;
+        }
+    }
+
+    return NG_OK;
+}
+
+static status_t reload_layer(Sint32 index, ngine_t* core)
+{
+    (void)index;
+    return bake_layers(core);
+}
 
-            stbsp_snprintf(sprite_image_source, source_length, "%s", file_name);
+static status_t reload_tileset(Sint32 index, ngine_t* core)
+{
+    char tileset_file_name[16] = { 0 };
 
-            core->map->sprite[index].id = index + 1;
+    (void)index;
+    stbsp_snprintf(tileset_file_name, 16, "%s", core->map->handle->tilesets->image.ptr);
 
-            status = load_texture_from_file(sprite_image_source, &core->map->sprite[index].texture, core);
-            if (NG_OK != status)
-            {
-                free(sprite_image_source);
-                return status;
-            }
+    return load_texture_from_file((const char*)tileset_file_name, &core->map->tileset_texture, core);
+}
+
+static status_t reload_sprite(Sint32 index, ngine_t* core)
+{
+    return load_texture_from_file(core->map->sprite[index].file_name, &core->map->sprite[index].texture, core);
+}
+
+// Runs on the thread that owns the renderer (see call_renderer()).  All
+// textures can be evicted and are re-created from the map data once
+// they are needed again; the layer texture is baked on first use.
+status_t load_map_textures(ngine_t* core)
+{
+    status_t status;
+    Sint32   index;
+
+    core->map->layer_slot   = register_texture(&core->map->layer_texture, reload_layer, 0, core);
+    core->map->tileset_slot = register_texture(&core->map->tileset_texture, reload_tileset, 0, core);
+
+    // Layers are baked from a copy of the tileset in the format of the
+    // layer texture.
+    core->map->bake_tileset = SDL_ConvertSurfaceFormat(core->map->tileset_surface, SDL_PIXELFORMAT_RGB444, 0);
+    if (! core->map->bake_tileset)
+    {
+        //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
+        return NG_ERROR;
+    }
+    SDL_SetSurfaceRLE(core->map->bake_tileset, 0);
+
+    status = load_texture_from_surface(&core->map->tileset_surface, &core->map->tileset_texture, core);
+    if (NG_OK != status)
+    {
+        return status;
+    }
+
+    for (index = 0; index < core->map->sprite_count; index += 1)
+    {
+        status = load_texture_from_surface(&core->map->sprite[index].surface, &core->map->sprite[index].texture, core);
+        if (NG_OK != status)
+        {
+            return status;
         }
+        core->map->sprite[index].texture_slot = register_texture(&core->map->sprite[index].texture, reload_sprite, index, core);
     }
 
-    return status;
+    return NG_OK;
+}
+
+void load_behaviour(Sint32 index, cute_tiled_property_t* properties, Sint32 property_count, ngine_t* core)
+{
+    entity_brain_t* brain = &core->map->entity.brain[index];
+    const char*     name  = get_string_property(H_behaviour, properties, property_count, core);
+    Sint32          rate  = (Sint32)get_integer_property(H_update_rate, properties, property_count, core);
+
+    if (! name)
+    {
+        return;
+    }
+
+    switch (generate_hash((const unsigned char*)name))
+    {
+        case H_wander:
+            brain->behaviour = B_WANDER;
+            break;
+        case H_follow_player:
+            brain->behaviour = B_FOLLOW_PLAYER;
+            break;
+        default:
+            //SDL_Log("Unknown behaviour: %s", name);
+            return;
+    }
+
+    if (rate <= 0)
+    {
+        rate = NG_SCHED_DEFAULT_RATE;
+    }
+
+    brain->interval    = (Uint32)(1000 / SDL_min(rate, 1000));
+    brain->seed        = (Uint32)core->map->entity.uid[index] * 2654435761U + 1U;
+    // Spread the first updates so entities with the same rate do not
+    // all become due in the same frame.
+    brain->next_update = brain->seed % brain->interval;
 }
 
 status_t load_entities(ngine_t* core)
 {
     cute_tiled_layer_t*  layer        = get_head_layer(core->map->handle);
     cute_tiled_object_t* tiled_object = NULL;
+    Sint32               count        = 0;
+    Sint32               capacity;
 
     if (core->map->entity_count)
     {
@@ -767,70 +915,95 @@ status_t load_entities(ngine_t* core)
             tiled_object = get_head_object(layer, core);
             while (tiled_object)
             {
-                core->map->entity_count += 1;
-                tiled_object            = tiled_object->next;
+                count        += 1;
+                tiled_object  = tiled_object->next;
             }
         }
         layer = layer->next;
     }
 
-    if (core->map->entity_count)
+    // Leave room for entities spawned at runtime.
+    capacity = get_integer_property(H_entity_capacity, core->map->handle->properties, get_map_property_count(core->map->handle), core);
+    if (capacity <= 0)
     {
-        core->map->entity = (entity_t*)calloc((size_t)core->map->entity_count, sizeof(struct entity));
-        if (! core->map->entity)
-        {
-            //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
-            return NG_ERROR;
-        }
+        capacity = count + NG_ENTITY_POOL_SPARE;
+    }
+    capacity = SDL_clamp(capacity, count, (Sint32)NG_ENTITY_INDEX_MASK);
+
+    if (count > capacity || NG_OK != alloc_entities(capacity, core))
+    {
+        return NG_ERROR;
     }
 
-    //SDL_Log("Load %u entities:", core->map->entity_count);
+    //SDL_Log("Load %u entities:", count);
 
     layer = get_head_layer(core->map->handle);
     while (layer)
     {
         if (is_tiled_layer_of_type(OBJECT_GROUP, layer, core))
         {
-            Sint32 index = 0;
             tiled_object = get_head_object(layer, core);
             while (tiled_object)
             {
-                entity_t*              entity     = &core->map->entity[index];
+                Sint32                 index      = add_entity(core);
+                entity_render_t*       render     = &core->map->entity.render[index];
+                entity_body_t*         body       = &core->map->entity.body[index];
+                animation_t*           animation  = &core->map->entity.animation[index];
                 cute_tiled_property_t* properties = tiled_object->properties;
                 Sint32                 prop_cnt   = get_object_property_count(tiled_object);
 
-                entity->handle                = tiled_object;
-                entity->state                 = S_DOWN | S_IDLE;
-                entity->pos_x                 = (Sint32)tiled_object->x;
-                entity->pos_y                 = (Sint32)tiled_object->y;
-                entity->uid                   = (Sint32)get_object_uid(tiled_object);
-                entity->id                    = (Sint32)index + 1;
-                entity->width                 = (Sint32)get_integer_property(H_width,     properties, prop_cnt, core);
-                entity->height                = (Sint32)get_integer_property(H_height,    properties, prop_cnt, core);
-                entity->sprite_id             = (Sint32)get_integer_property(H_sprite_id, properties, prop_cnt, core);
-                entity->animation.first_frame = (Sint32)1;
-                entity->animation.fps         = (Sint32)0;
-                entity->animation.length      = (Sint32)0;
-                entity->animation.offset_y    = (Sint32)1;
-
-                if (entity->width <= 0)
+                core->map->entity.handle[index] = tiled_object;
+                core->map->entity.state[index]  = S_DOWN | S_IDLE;
+                core->map->entity.pos_x[index]  = (Sint32)tiled_object->x;
+                core->map->entity.pos_y[index]  = (Sint32)tiled_object->y;
+                core->map->entity.uid[index]    = (Sint32)get_object_uid(tiled_object);
+
+                render->width          = (Sint32)get_integer_property(H_width,       properties, prop_cnt, core);
+                render->height         = (Sint32)get_integer_property(H_height,      properties, prop_cnt, core);
+                render->sprite_id      = (Sint32)get_integer_property(H_sprite_id,   properties, prop_cnt, core);
+                render->sprite_cols    = (Sint32)get_integer_property(H_sprite_cols, properties, prop_cnt, core);
+                animation->first_frame = (Sint32)1;
+                animation->fps         = (Sint32)0;
+                animation->length      = (Sint32)0;
+                animation->offset_y    = (Sint32)1;
+
+                if (render->width <= 0)
+                {
+                    render->width = get_tile_width(core->map->handle);
+                }
+
+                if (render->height <= 0)
+                {
+                    render->height = get_tile_height(core->map->handle);
+                }
+
+                // The bounding box used for collisions defaults to the
+                // size of the sprite.
+                body->width  = (Sint32)get_integer_property(H_hitbox_width,  properties, prop_cnt, core);
+                body->height = (Sint32)get_integer_property(H_hitbox_height, properties, prop_cnt, core);
+
+                if (body->width <= 0)
                 {
-                    entity->width = get_tile_width(core->map->handle);
+                    body->width = render->width;
                 }
 
-                if (entity->height <= 0)
+                if (body->height <= 0)
                 {
-                    entity->width = get_tile_height(core->map->handle);
+                    body->height = render->height;
                 }
 
                 if (get_boolean_property(H_is_player, properties, prop_cnt, core))
                 {
-                    core->map->active_entity = entity->id;
-                    core->camera.is_locked   = SDL_TRUE;
+                    core->map->active_entity                   = get_entity_handle(index, core);
+                    core->map->entity.motion[index].is_enabled = SDL_TRUE;
+                    core->camera.is_locked                     = SDL_TRUE;
+                }
+                else
+                {
+                    load_behaviour(index, properties, prop_cnt, core);
                 }
 
-                index        += 1;
-                tiled_object  = tiled_object->next;
+                tiled_object = tiled_object->next;
             }
         }
         layer = layer->next;
@@ -839,6 +1012,72 @@ status_t load_entities(ngine_t* core)
     return NG_OK;
 }
 
+status_t load_triggers(ngine_t* core)
+{
+    Sint32 tile_w     = get_tile_width(core->map->handle);
+    Sint32 tile_h     = get_tile_height(core->map->handle);
+    Sint32 count      = 0;
+    Sint32 slot_count = 0;
+    Sint32 index;
+
+    // Count triggers and an upper bound of the tiles they cover.
+    for (index = 0; index < core->map->entity_count; index += 1)
+    {
+        cute_tiled_object_t* tiled_object = core->map->entity.handle[index];
+        Sint32               prop_cnt     = get_object_property_count(tiled_object);
+
+        if (get_string_property(H_display_text, tiled_object->properties, prop_cnt, core))
+        {
+            count      += 1;
+            slot_count += (((Sint32)tiled_object->width  + tile_w - 1) / tile_w + 1) *
+                          (((Sint32)tiled_object->height + tile_h - 1) / tile_h + 1);
+        }
+    }
+
+    if (NG_OK != alloc_triggers(count, slot_count, core))
+    {
+        return NG_ERROR;
+    }
+
+    for (index = 0; index < core->map->entity_count; index += 1)
+    {
+        cute_tiled_object_t* tiled_object = core->map->entity.handle[index];
+        Sint32               prop_cnt     = get_object_property_count(tiled_object);
+        const char*          text         = get_string_property(H_display_text, tiled_object->properties, prop_cnt, core);
+
+        if (text)
+        {
+            add_trigger(index, TRIGGER_DISPLAY_TEXT, text, (Sint32)tiled_object->width, (Sint32)tiled_object->height, core);
+        }
+    }
+
+    return NG_OK;
+}
+
+// Gravity is stored in 1/100000 m/s^2 as an integer; a decimal value
+// is taken as m/s^2.  Decimals are only converted once here.  The map
+// is not flagged as loaded yet, so the properties are read directly.
+void load_physics(ngine_t* core)
+{
+    cute_tiled_property_t* properties     = core->map->handle->properties;
+    Sint32                 prop_cnt       = get_map_property_count(core->map->handle);
+    Sint32                 gravity        = (Sint32)get_integer_property(H_gravity,        properties, prop_cnt, core);
+    Sint32                 meter_in_pixel = (Sint32)get_integer_property(H_meter_in_pixel, properties, prop_cnt, core);
+    Sint32                 jump_height    = (Sint32)get_integer_property(H_jump_height,    properties, prop_cnt, core);
+
+    if (0 == gravity)
+    {
+        gravity = (Sint32)(get_decimal_property(H_gravity, properties, prop_cnt, core) * 100000.f);
+    }
+
+    if (0 == meter_in_pixel)
+    {
+        meter_in_pixel = (Sint32)get_decimal_property(H_meter_in_pixel, properties, prop_cnt, core);
+    }
+
+    init_physics(gravity, meter_in_pixel, jump_height, core);
+}
+
 status_t load_font(ngine_t* core)
 {
     status_t status = NG_OK;
@@ -854,354 +1093,543 @@ status_t load_font(ngine_t* core)
     return status;
 }
 
-status_t render_scene(ngine_t* core)
+// Advances the animation of an entity and records how to draw it.
+// Returns SDL_FALSE if the entity is not visible.
+SDL_bool snapshot_entity(Sint32 index, draw_entity_t* draw, ngine_t* core)
 {
-    cute_tiled_layer_t* layer;
-    Sint32              index;
+    animation_t*           animation  = &core->map->entity.animation[index];
+    entity_render_t*       render     = &core->map->entity.render[index];
+    Uint32                 state      = core->map->entity.state[index];
+    cute_tiled_property_t* properties = core->map->entity.handle[index]->properties;
+    Sint32                 prop_cnt   = get_object_property_count(core->map->entity.handle[index]);
+    Sint32                 pos_x      = core->map->entity.pos_x[index] - core->camera.pos_x;
+    Sint32                 pos_y      = core->map->entity.pos_y[index] - core->camera.pos_y;
+    SDL_Rect*              src        = &draw->src;
+    SDL_Rect*              dst        = &draw->dst;
+    SDL_bool               is_walking = SDL_FALSE;
 
-    if (! core->is_map_loaded)
+    if (IS_STATE_SET(state, S_WALK))
     {
-        return NG_OK;
+        is_walking = SDL_TRUE;
     }
 
-    // Update and render animated tiles.
-    core->map->time_since_last_anim_frame += core->time_since_last_frame;
-
-    if (0 < core->map->animated_tile_index && core->map->time_since_last_anim_frame >= (Uint32)(1000 / ANIM_TILE_FPS))
+    if (IS_STATE_SET(state, S_RIGHT))
     {
-        core->map->time_since_last_anim_frame = 0;
-
-        if (0 > SDL_SetRenderTarget(core->renderer, core->map->layer_texture))
+        if (is_walking)
         {
-            //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
-            return NG_ERROR;
+            animation->length      = (Sint32)get_integer_property(H_anim_walk_right_len,   properties, prop_cnt, core);
+            animation->first_frame = (Sint32)get_integer_property(H_anim_walk_right_index, properties, prop_cnt, core);
         }
-
-        for (index = 0; core->map->animated_tile_index > index; index += 1)
+        else
         {
-            cute_tiled_tileset_t* tileset;
-            Sint32                gid          = core->map->animated_tile[index].gid;
-            Sint32                next_tile_id = 0;
-            Sint32                local_id;
-            SDL_Rect              dst          = { 0 };
-            SDL_Rect              src          = { 0 };
-
-            local_id = core->map->animated_tile[index].id + 1;
-            tileset  = get_head_tileset(core->map->handle);
-            src.w    = dst.w = get_tile_width(core->map->handle);
-            src.h    = dst.h = get_tile_height(core->map->handle);
-            dst.x    = core->map->animated_tile[index].dst_x;
-            dst.y    = core->map->animated_tile[index].dst_y;
-
-            get_tile_position(local_id, (Uint32*)&src.x, (Uint32*)&src.y, core->map->handle);
-
-            if (0 > SDL_RenderCopy(core->renderer, core->map->tileset_texture, &src, &dst))
-            {
-                //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
-                return NG_ERROR;
-            }
-
-            core->map->animated_tile[index].current_frame += 1;
-
-            if (core->map->animated_tile[index].current_frame >= core->map->animated_tile[index].animation_length)
-            {
-                core->map->animated_tile[index].current_frame = 0;
-            }
-
-            next_tile_id = get_next_animated_tile_id(gid, core->map->animated_tile[index].current_frame, core->map->handle);
-
-            core->map->animated_tile[index].id = next_tile_id;
+            animation->length      = (Sint32)get_integer_property(H_anim_idle_right_len,   properties, prop_cnt, core);
+            animation->first_frame = (Sint32)get_integer_property(H_anim_idle_right_index, properties, prop_cnt, core);
         }
     }
-
-    if (NG_OK != create_and_set_render_target(&core->render_target, core))
+    else if (IS_STATE_SET(state, S_LEFT))
     {
-        return NG_ERROR;
+        if (is_walking)
+        {
+            animation->length      = (Sint32)get_integer_property(H_anim_walk_left_len,   properties, prop_cnt, core);
+            animation->first_frame = (Sint32)get_integer_property(H_anim_walk_left_index, properties, prop_cnt, core);
+        }
+        else
+        {
+            animation->length      = (Sint32)get_integer_property(H_anim_idle_left_len,   properties, prop_cnt, core);
+            animation->first_frame = (Sint32)get_integer_property(H_anim_idle_left_index, properties, prop_cnt, core);
+        }
     }
-
-    layer = get_head_layer(core->map->handle);
-
-    // Texture has already been rendered.
-    if (core->map->layer_texture)
+    else if (IS_STATE_SET(state, S_UP))
     {
-        Sint32   render_pos_x = 0 - core->camera.pos_x;
-        Sint32   render_pos_y = 0 - core->camera.pos_y;
-        SDL_Rect dst          = {
-            (Sint32)render_pos_x,
-            (Sint32)render_pos_y,
-            (Sint32)core->map->width,
-            (Sint32)core->map->height
-        };
-
-        if (0 > SDL_RenderCopyEx(core->renderer, core->map->layer_texture, NULL, &dst, 0, NULL, SDL_FLIP_NONE))
+        if (is_walking)
         {
-            //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
-            return NG_ERROR;
+            animation->length      = (Sint32)get_integer_property(H_anim_walk_up_len,   properties, prop_cnt, core);
+            animation->first_frame = (Sint32)get_integer_property(H_anim_walk_up_index, properties, prop_cnt, core);
         }
-
-        // Update and render entity entities.
-        index = 0;
-        while (layer && core->map->entity_count)
+        else
         {
-            if (is_tiled_layer_of_type(OBJECT_GROUP, layer, core))
-            {
-                cute_tiled_object_t* tiled_object = get_head_object(layer, core);
-                while (tiled_object)
-                {
-                    entity_t*              entity      = &core->map->entity[index];
-                    cute_tiled_property_t* properties  = tiled_object->properties;
-                    Sint32                 prop_cnt    = get_object_property_count(tiled_object);
-                    Sint32                 pos_x       = entity->pos_x - core->camera.pos_x;
-                    Sint32                 pos_y       = entity->pos_y - core->camera.pos_y;
-                    SDL_Rect               src         = { 0 };
-                    SDL_bool               is_walking  = SDL_FALSE;
-                    Sint32                 sprite_cols = (Sint32)get_integer_property(H_sprite_cols, properties, prop_cnt, core);
-
-                    if (IS_STATE_SET(entity->state, S_WALK))
-                    {
-                        is_walking = SDL_TRUE;
-                    }
+            animation->length      = (Sint32)get_integer_property(H_anim_idle_up_len,   properties, prop_cnt, core);
+            animation->first_frame = (Sint32)get_integer_property(H_anim_idle_up_index, properties, prop_cnt, core);
+        }
+    }
+    else if (IS_STATE_SET(state, S_DOWN))
+    {
+        if (is_walking)
+        {
+            animation->length      = (Sint32)get_integer_property(H_anim_walk_down_len,   properties, prop_cnt, core);
+            animation->first_frame = (Sint32)get_integer_property(H_anim_walk_down_index, properties, prop_cnt, core);
+        }
+        else
+        {
+            animation->length      = (Sint32)get_integer_property(H_anim_idle_down_len,   properties, prop_cnt, core);
+            animation->first_frame = (Sint32)get_integer_property(H_anim_idle_down_index, properties, prop_cnt, core);
+        }
+    }
+    animation->first_frame -= 1;
 
-                    if (IS_STATE_SET(entity->state, S_RIGHT))
-                    {
-                        if (is_walking)
-                        {
-                            entity->animation.length      = (Sint32)get_integer_property(H_anim_walk_right_len,   properties, prop_cnt, core);
-                            entity->animation.first_frame = (Sint32)get_integer_property(H_anim_walk_right_index, properties, prop_cnt, core);
-                        }
-                        else
-                        {
-                            entity->animation.length      = (Sint32)get_integer_property(H_anim_idle_right_len,   properties, prop_cnt, core);
-                            entity->animation.first_frame = (Sint32)get_integer_property(H_anim_idle_right_index, properties, prop_cnt, core);
-                        }
-                    }
-                    else if (IS_STATE_SET(entity->state, S_LEFT))
-                    {
-                        if (is_walking)
-                        {
-                            entity->animation.length      = (Sint32)get_integer_property(H_anim_walk_left_len,   properties, prop_cnt, core);
-                            entity->animation.first_frame = (Sint32)get_integer_property(H_anim_walk_left_index, properties, prop_cnt, core);
-                        }
-                        else
-                        {
-                            entity->animation.length      = (Sint32)get_integer_property(H_anim_idle_left_len,   properties, prop_cnt, core);
-                            entity->animation.first_frame = (Sint32)get_integer_property(H_anim_idle_left_index, properties, prop_cnt, core);
-                        }
-                    }
-                    else if (IS_STATE_SET(entity->state, S_UP))
-                    {
-                        if (is_walking)
-                        {
-                            entity->animation.length      = (Sint32)get_integer_property(H_anim_walk_up_len,   properties, prop_cnt, core);
-                            entity->animation.first_frame = (Sint32)get_integer_property(H_anim_walk_up_index, properties, prop_cnt, core);
-                        }
-                        else
-                        {
-                            entity->animation.length      = (Sint32)get_integer_property(H_anim_idle_up_len,   properties, prop_cnt, core);
-                            entity->animation.first_frame = (Sint32)get_integer_property(H_anim_idle_up_index, properties, prop_cnt, core);
-                        }
-                    }
-                    else if (IS_STATE_SET(entity->state, S_DOWN))
-                    {
-                        if (is_walking)
-                        {
-                            entity->animation.length      = (Sint32)get_integer_property(H_anim_walk_down_len,   properties, prop_cnt, core);
-                            entity->animation.first_frame = (Sint32)get_integer_property(H_anim_walk_down_index, properties, prop_cnt, core);
-                        }
-                        else
-                        {
-                            entity->animation.length      = (Sint32)get_integer_property(H_anim_idle_down_len,   properties, prop_cnt, core);
-                            entity->animation.first_frame = (Sint32)get_integer_property(H_anim_idle_down_index, properties, prop_cnt, core);
-                        }
-                    }
-                    entity->animation.first_frame -= 1;
+    if (animation->length > 1)
+    {
+        animation->time_since_last_anim_frame += core->time_since_last_frame;
+    }
 
-                    if (entity->animation.length > 1)
-                    {
-                        entity->animation.time_since_last_anim_frame += core->time_since_last_frame;
-                    }
+    if (animation->length > 1 && '\0' == core->display_text[0])
+    {
+        animation->time_since_last_anim_frame += core->time_since_last_frame;
+        animation->fps                        = (Sint32)get_integer_property(H_anim_fps, properties, prop_cnt, core);
 
-                    if (entity->animation.length > 1 && !core->display_text)
-                    {
-                        entity->animation.time_since_last_anim_frame += core->time_since_last_frame;
-                        entity->animation.fps                         = (Sint32)get_integer_property(H_anim_fps, properties, prop_cnt, core);
+        if (animation->time_since_last_anim_frame >= (Uint32)(1000 / animation->fps))
+        {
+            animation->time_since_last_anim_frame  = 0;
+            animation->current_frame              += 1;
 
-                        if (entity->animation.time_since_last_anim_frame >= (Uint32)(1000 / entity->animation.fps))
-                        {
-                            entity->animation.time_since_last_anim_frame  = 0;
-                            entity->animation.current_frame              += 1;
+            if (animation->current_frame >= animation->length)
+            {
+                animation->current_frame = 0;
+            }
+        }
+    }
+    else
+    {
+        animation->current_frame = 0;
+        //get_frame_position(animation->first_frame, render->width, render->height, &src.x, &src.y, render->sprite_cols);
+    }
+    get_frame_position(animation->first_frame + animation->current_frame, render->width, render->height, &src->x, &src->y, render->sprite_cols);
 
-                            if (entity->animation.current_frame >= entity->animation.length)
-                            {
-                                entity->animation.current_frame = 0;
-                            }
-                        }
-                    }
-                    else
-                    {
-                        entity->animation.current_frame = 0;
-                        //get_frame_position(entity->animation.first_frame, entity->width, entity->height, &src.x, &src.y, sprite_cols);
-                    }
-                    get_frame_position(entity->animation.first_frame + entity->animation.current_frame, entity->width, entity->height, &src.x, &src.y, sprite_cols);
-
-                    src.w  = entity->width;
-                    src.h  = entity->height;
-                    dst.x  = (Sint32)pos_x - (entity->width  / 2);
-                    dst.y  = (Sint32)pos_y - (entity->height / 2);
-                    dst.w  = entity->width;
-                    dst.h  = entity->height;
-
-                    // We do not need to draw entities that are not
-                    // inside the viewport.
-                    if ((dst.x > (0 - entity->width)) && (dst.x < 176))
+    src->w = render->width;
+    src->h = render->height;
+    dst->x = (Sint32)pos_x - (render->width  / 2);
+    dst->y = (Sint32)pos_y - (render->height / 2);
+    dst->w = render->width;
+    dst->h = render->height;
+
+    // The grid query is coarse: we do not need to draw entities
+    // that are not inside the viewport.
+    if ((dst->x <= (0 - render->width)) || (dst->x >= 176))
+    {
+        return SDL_FALSE;
+    }
+
+    if ((dst->y <= (0 - render->height)) || (dst->y >= 208))
+    {
+        return SDL_FALSE;
+    }
+
+    draw->sprite_id = render->sprite_id;
+
+    if (core->debug_mode)
+    {
+        SDL_Rect* tile_frame = &draw->debug_frame;
+        Sint32    tile_index;
+
+        tile_index = get_tile_index(core->map->entity.pos_x[index], core->map->entity.pos_y[index], core);
+
+        tile_frame->w = get_tile_width(core->map->handle);
+        tile_frame->h = get_tile_height(core->map->handle);
+        tile_frame->x = (tile_index % core->map->handle->width) * tile_frame->w;
+        tile_frame->y = (tile_index / core->map->handle->width) * tile_frame->h;
+
+        tile_frame->x = tile_frame->x - core->camera.pos_x;
+        tile_frame->y = tile_frame->y - core->camera.pos_y;
+
+        draw->is_debug_solid = is_tile_attr_set(TA_SOLID, tile_index % core->map->handle->width, tile_index / core->map->handle->width, core);
+    }
+
+    return SDL_TRUE;
+}
+
+// Called on the simulation side: advances animations and captures
+// everything the renderer needs into the given snapshot.
+void build_snapshot(snapshot_t* snapshot, ngine_t* core)
+{
+    Sint32 index;
+
+    snapshot->map_serial    = core->map_serial;
+    snapshot->is_map_loaded = (core->is_map_loaded && core->map) ? SDL_TRUE : SDL_FALSE;
+    snapshot->debug_mode    = core->debug_mode;
+    snapshot->camera_x      = core->camera.pos_x;
+    snapshot->camera_y      = core->camera.pos_y;
+    snapshot->entity_count  = 0;
+    snapshot->has_text      = ('\0' != core->display_text[0]) ? SDL_TRUE : SDL_FALSE;
+
+    if (snapshot->has_text)
+    {
+        stbsp_snprintf(snapshot->display_text, NG_DISPLAY_TEXT_SIZE, "%s", core->display_text);
+    }
+
+    if (snapshot->debug_mode)
+    {
+        Sint32 length = format_profile_stats(snapshot->debug_text, NG_DEBUG_TEXT_SIZE, core);
+
+        length += format_stats(snapshot->debug_text + length, NG_DEBUG_TEXT_SIZE - length, core);
+        format_memory_stats(snapshot->debug_text + length, NG_DEBUG_TEXT_SIZE - length, core);
+    }
+
+    if (! snapshot->is_map_loaded)
+    {
+        return;
+    }
+
+    // Update animated tiles.
+    core->map->time_since_last_anim_frame += core->time_since_last_frame;
+
+    if (0 < core->map->animated_tile_index && core->map->time_since_last_anim_frame >= (Uint32)(1000 / ANIM_TILE_FPS))
+    {
+        core->map->time_since_last_anim_frame  = 0;
+        core->map->animated_tile_version      += 1;
+
+        for (index = 0; core->map->animated_tile_index > index; index += 1)
+        {
+            animated_tile_t* animated_tile = &core->map->animated_tile[index];
+
+            animated_tile->current_frame += 1;
+
+            if (animated_tile->current_frame >= animated_tile->animation_length)
+            {
+                animated_tile->current_frame = 0;
+            }
+
+            animated_tile->id = get_next_animated_tile_id(animated_tile->gid, animated_tile->current_frame, core->map->handle);
+        }
+    }
+
+    // Buffers are re-used: only copy the tiles if they changed since
+    // this buffer has last been written.
+    if (snapshot->tile_version != core->map->animated_tile_version)
+    {
+        snapshot->tile_count   = SDL_min(core->map->animated_tile_index, snapshot->tile_capacity);
+        snapshot->tile_version = core->map->animated_tile_version;
+
+        for (index = 0; index < snapshot->tile_count; index += 1)
+        {
+            draw_tile_t* tile = &snapshot->tile[index];
+
+            tile->src.w = tile->dst.w = get_tile_width(core->map->handle);
+            tile->src.h = tile->dst.h = get_tile_height(core->map->handle);
+            tile->dst.x = core->map->animated_tile[index].dst_x;
+            tile->dst.y = core->map->animated_tile[index].dst_y;
+
+            get_tile_position(core->map->animated_tile[index].id + 1, (Sint32*)&tile->src.x, (Sint32*)&tile->src.y, core->map->handle);
+        }
+    }
+
+    // Update entities inside the viewport.
+    if (core->map->entity_count)
+    {
+        Sint32 count = query_grid_rect(
+            core->camera.pos_x,
+            core->camera.pos_y,
+            176, 208,
+            core->map->grid.result,
+            core->map->grid.capacity,
+            core);
+
+        // Draw back to front.
+        update_draw_order(core);
+        sort_by_draw_order(core->map->grid.result, count, core);
+
+        for (index = 0; index < count && snapshot->entity_count < snapshot->entity_capacity; index += 1)
+        {
+            if (snapshot_entity(core->map->grid.result[index], &snapshot->entity[snapshot->entity_count], core))
+            {
+                snapshot->entity_count += 1;
+            }
+        }
+    }
+}
+
+// Copies a tile between 16-bit surfaces, skipping the colour key.
+static void copy_tile(const SDL_Surface* src, Sint32 src_x, Sint32 src_y, SDL_Surface* dst, Sint32 dst_x, Sint32 dst_y, Sint32 width, Sint32 height, Uint32 key)
+{
+    Sint32 pos_x;
+    Sint32 pos_y;
+
+    width  = SDL_min(width,  SDL_min(src->w - src_x, dst->w - dst_x));
+    height = SDL_min(height, SDL_min(src->h - src_y, dst->h - dst_y));
+
+    for (pos_y = 0; pos_y < height; pos_y += 1)
+    {
+        const Uint16* src_row = (const Uint16*)((const Uint8*)src->pixels + ((src_y + pos_y) * src->pitch)) + src_x;
+        Uint16*       dst_row = (Uint16*)((Uint8*)dst->pixels + ((dst_y + pos_y) * dst->pitch)) + dst_x;
+
+        for (pos_x = 0; pos_x < width; pos_x += 1)
+        {
+            if (key != src_row[pos_x])
+            {
+                dst_row[pos_x] = src_row[pos_x];
+            }
+        }
+    }
+}
+
+// Bakes the tile rows [first, first + count) of all visible tile layers
+// into the bake surface.  Bands never overlap and only read the map and
+// the tileset, so that they can be baked on several threads.
+static status_t bake_band(Sint32 first, Sint32 count, ngine_t* core)
+{
+    cute_tiled_map_t*   handle  = core->map->handle;
+    SDL_Surface*        tileset = core->map->bake_tileset;
+    SDL_Surface*        target  = core->map->bake_surface;
+    cute_tiled_layer_t* layer   = get_head_layer(handle);
+    Sint32              tile_w  = get_tile_width(handle);
+    Sint32              tile_h  = get_tile_height(handle);
+    Sint32              last    = SDL_min(first + count, (Sint32)handle->height);
+    Uint32              key     = 0xffff; // RGB444 never sets the upper nibble.
+    Sint32              row;
+    Sint32              col;
+
+    SDL_GetColorKey(tileset, &key);
+
+    for (row = first; row < last; row += 1)
+    {
+        Sint32 pos_y = (row - core->map->bake_first_row) * tile_h;
+
+        SDL_memset((Uint8*)target->pixels + (pos_y * target->pitch), 0, (size_t)(tile_h * target->pitch));
+    }
+
+    while (layer)
+    {
+        if (is_tiled_layer_of_type(TILE_LAYER, layer, core) && layer->visible)
+        {
+            Sint32* layer_content = get_layer_content(layer);
+
+            for (row = first; row < last; row += 1)
+            {
+                for (col = 0; col < (Sint32)handle->width; col += 1)
+                {
+                    Sint32 gid = remove_gid_flip_bits((Sint32)layer_content[(row * (Sint32)handle->width) + col]);
+                    Sint32 src_x;
+                    Sint32 src_y;
+
+                    if (is_gid_valid(gid, handle))
                     {
-                        if ((dst.y > (0 - entity->height)) && (dst.y < 208))
-                        {
-                            // We do not draw entities that have no
-                            // sprite either and if the sprite requested
-                            // does not exist, there is also nothing to
-                            // do here.
-                            if ((entity->sprite_id > 0) && &core->map->sprite[entity->sprite_id - 1])
-                            {
-                                if (core->map->sprite[entity->sprite_id - 1].texture)
-                                {
-                                    if (0 > SDL_RenderCopyEx(core->renderer, core->map->sprite[entity->sprite_id - 1].texture, &src, &dst, 0, NULL, SDL_FLIP_NONE))
-                                    {
-                                        //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
-                                        return NG_ERROR;
-                                    }
-                                }
-                            }
-                            if (core->debug_mode)
-                            {
-                                SDL_Rect tile_frame = { 0 };
-                                Sint32   tile_index;
-
-                                tile_index = get_tile_index(entity->pos_x, entity->pos_y, core);
-
-                                tile_frame.w = get_tile_width(core->map->handle);
-                                tile_frame.h = get_tile_height(core->map->handle);
-                                tile_frame.x = (tile_index % core->map->handle->width) * tile_frame.w;
-                                tile_frame.y = (tile_index / core->map->handle->width) * tile_frame.h;
-
-                                tile_frame.x = tile_frame.x - core->camera.pos_x;
-                                tile_frame.y = tile_frame.y - core->camera.pos_y;
-
-                                if (core->map->tile_desc[tile_index].is_solid)
-                                {
-                                    SDL_SetRenderDrawColor(core->renderer, 0xff, 0x00, 0x00, 0x00);
-                                }
-                                else
-                                {
-                                    SDL_SetRenderDrawColor(core->renderer, 0x00, 0xff, 0x00, 0x00);
-                                }
-                                SDL_RenderDrawRect(core->renderer, &tile_frame);
-                            }
-                        }
+                        get_tile_position(gid, &src_x, &src_y, handle);
+                        copy_tile(tileset, src_x, src_y, target, col * tile_w, (row - core->map->bake_first_row) * tile_h, tile_w, tile_h, key);
                     }
-                    index        += 1;
-                    tiled_object  = tiled_object->next;
                 }
             }
-            layer = layer->next;
         }
+        layer = layer->next;
+    }
 
-        if (core->display_text)
-        {
-            render_text(core);
-        }
+    return NG_OK;
+}
 
-        return NG_OK;
+// Called on the render side with the renderer locked, so that the job
+// system is not used by the loader at the same time.
+status_t bake_layers(ngine_t* core)
+{
+    cute_tiled_map_t* handle    = core->map->handle;
+    Sint32            tile_h    = get_tile_height(handle);
+    Sint32            rows      = (Sint32)handle->height;
+    Sint32            band_rows = NG_BAKE_BAND_ROWS;
+    Sint32            first;
+    status_t          status    = NG_OK;
+
+    if (! core->map->bake_tileset)
+    {
+        return NG_ERROR;
     }
 
-    // Texture does not yet exist. Render it!
-    core->map->layer_texture = SDL_CreateTexture(
-        core->renderer,
+    core->map->layer_texture = create_texture(
         SDL_PIXELFORMAT_RGB444,
         SDL_TEXTUREACCESS_TARGET,
         (Sint32)core->map->width,
-        (Sint32)core->map->height);
+        (Sint32)core->map->height,
+        core);
 
     if (! core->map->layer_texture)
     {
-        //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
         return NG_ERROR;
     }
 
-    if (0 > SDL_SetRenderTarget(core->renderer, core->map->layer_texture))
+    // With worker threads, all bands are baked at once and uploaded in
+    // one go.  Without, a single band is baked and uploaded at a time,
+    // which keeps the extra memory down to one band.
+    if (get_job_worker_count(core) > 0)
+    {
+        band_rows = SDL_max(band_rows, (rows + NG_MAX_JOBS - 1) / NG_MAX_JOBS);
+        core->map->bake_surface = SDL_CreateRGBSurfaceWithFormat(0, core->map->width, rows * tile_h, 16, SDL_PIXELFORMAT_RGB444);
+    }
+    else
+    {
+        core->map->bake_surface = SDL_CreateRGBSurfaceWithFormat(0, core->map->width, band_rows * tile_h, 16, SDL_PIXELFORMAT_RGB444);
+    }
+
+    if (! core->map->bake_surface)
     {
         //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
         return NG_ERROR;
     }
-    SDL_RenderClear(core->renderer);
 
-    while (layer)
+    if (get_job_worker_count(core) > 0)
     {
-        SDL_Rect dst = { 0 };
-        SDL_Rect src = { 0 };
+        core->map->bake_first_row = 0;
 
-        if (is_tiled_layer_of_type(TILE_LAYER, layer, core))
+        for (first = 0; first < rows; first += band_rows)
         {
-            Sint32 prop_cnt = get_layer_property_count(layer);
+            add_job("bake band", bake_band, first, band_rows, core);
+        }
 
-            if (layer->visible)
+        status = run_jobs(core);
+        if (NG_OK == status && 0 > SDL_UpdateTexture(core->map->layer_texture, NULL, core->map->bake_surface->pixels, core->map->bake_surface->pitch))
+        {
+            //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
+            status = NG_ERROR;
+        }
+    }
+    else
+    {
+        for (first = 0; first < rows && NG_OK == status; first += band_rows)
+        {
+            SDL_Rect dst = { 0, first * tile_h, core->map->width, SDL_min(band_rows, rows - first) * tile_h };
+
+            core->map->bake_first_row = first;
+            bake_band(first, band_rows, core);
+
+            if (0 > SDL_UpdateTexture(core->map->layer_texture, &dst, core->map->bake_surface->pixels, core->map->bake_surface->pitch))
             {
-                Sint32 index_height;
-                Sint32 index_width;
+                //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
+                status = NG_ERROR;
+            }
+        }
+    }
 
-                for (index_height = 0; index_height < (Sint32)core->map->handle->height; index_height += 1)
-                {
-                    for (index_width = 0; index_width < (Sint32)core->map->handle->width; index_width += 1)
-                    {
-                        Sint32* layer_content = get_layer_content(layer);
-                        Sint32  gid           = remove_gid_flip_bits((Sint32)layer_content[(index_height * (Sint32)core->map->handle->width) + index_width]);
-                        Sint32  local_id      = gid - get_first_gid(core->map->handle);
+    SDL_FreeSurface(core->map->bake_surface);
+    core->map->bake_surface = NULL;
 
-                        if (is_gid_valid(gid, core->map->handle))
-                        {
-                            cute_tiled_tileset_t* tileset          = get_head_tileset(core->map->handle);
-                            Sint32                animation_length = 0;
-                            Sint32                id               = 0;
-
-                            src.w = dst.w = get_tile_width(core->map->handle);
-                            src.h = dst.h = get_tile_height(core->map->handle);
-                            dst.x = (Sint32)(index_width  * get_tile_width(core->map->handle));
-                            dst.y = (Sint32)(index_height * get_tile_height(core->map->handle));
-
-                            get_tile_position(gid, (Uint32*)&src.x, (Uint32*)&src.y, core->map->handle);
-                            SDL_RenderCopy(core->renderer, core->map->tileset_texture, &src, &dst);
-
-                            if (is_tile_animated(gid, &animation_length, &id, core->map->handle))
-                            {
-                                core->map->animated_tile[core->map->animated_tile_index].gid              = get_local_id(gid, core->map->handle);
-                                core->map->animated_tile[core->map->animated_tile_index].id               = id;
-                                core->map->animated_tile[core->map->animated_tile_index].dst_x            = dst.x;
-                                core->map->animated_tile[core->map->animated_tile_index].dst_y            = dst.y;
-                                core->map->animated_tile[core->map->animated_tile_index].current_frame    = 0;
-                                core->map->animated_tile[core->map->animated_tile_index].animation_length = animation_length;
-
-                                core->map->animated_tile_index += 1;
-                            }
-                        }
-                    }
-                }
+    // The animated tiles have been drawn with their first frame.
+    core->render.tile_version = (Uint32)-1;
 
+    return status;
+}
+
+// Called on the render side: only reads the snapshot and the textures
+// owned by the map, never the simulation state.
+status_t render_snapshot(const snapshot_t* snapshot, ngine_t* core)
+{
+    Sint32   index;
+    Uint64   start;
+    status_t status;
+
+    // A snapshot taken before the last map change is stale.
+    if (! snapshot->is_map_loaded || ! core->map || snapshot->map_serial != core->map_serial)
+    {
+        return draw_scene(SDL_FALSE, core);
+    }
+
+    start = begin_profile();
+
+    next_texture_frame(core);
+
+    // Without the layer texture, there is nothing to draw onto.
+    if (NG_OK != use_texture(core->map->layer_slot, core) || ! core->map->layer_texture)
+    {
+        return draw_scene(SDL_FALSE, core);
+    }
+
+    // Update animated tiles.  If the tileset is missing, they are updated
+    // once it is back.
+    if (snapshot->tile_count > 0 && snapshot->tile_version != core->render.tile_version &&
+        NG_OK == use_texture(core->map->tileset_slot, core) && core->map->tileset_texture)
+    {
+        if (0 > SDL_SetRenderTarget(core->renderer, core->map->layer_texture))
+        {
+            //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
+            return NG_ERROR;
+        }
+
+        for (index = 0; index < snapshot->tile_count; index += 1)
+        {
+            if (0 > SDL_RenderCopy(core->renderer, core->map->tileset_texture, &snapshot->tile[index].src, &snapshot->tile[index].dst))
+            {
+                //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
+                return NG_ERROR;
+            }
+            count_draw(core->map->tileset_texture, &snapshot->tile[index].dst, core);
+        }
+
+        core->render.tile_version = snapshot->tile_version;
+    }
+
+    if (NG_OK != set_frame_target(core))
+    {
+        return NG_ERROR;
+    }
+
+    {
+        SDL_Rect dst = {
+            (Sint32)(0 - snapshot->camera_x),
+            (Sint32)(0 - snapshot->camera_y),
+            (Sint32)core->map->width,
+            (Sint32)core->map->height
+        };
+
+        if (0 > SDL_RenderCopyEx(core->renderer, core->map->layer_texture, NULL, &dst, 0, NULL, SDL_FLIP_NONE))
+        {
+            //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
+            return NG_ERROR;
+        }
+        count_draw(core->map->layer_texture, &dst, core);
+    }
+
+    for (index = 0; index < snapshot->entity_count; index += 1)
+    {
+        const draw_entity_t* draw = &snapshot->entity[index];
+
+        // We do not draw entities that have no sprite either and if the
+        // sprite requested does not exist, there is also nothing to do
+        // here.
+        if ((draw->sprite_id > 0) && (draw->sprite_id <= core->map->sprite_count))
+        {
+            use_texture(core->map->sprite[draw->sprite_id - 1].texture_slot, core);
+
+            if (core->map->sprite[draw->sprite_id - 1].texture)
+            {
+                if (0 > SDL_RenderCopyEx(core->renderer, core->map->sprite[draw->sprite_id - 1].texture, &draw->src, &draw->dst, 0, NULL, SDL_FLIP_NONE))
                 {
-                    const char* layer_name = get_layer_name(layer);
-                    //SDL_Log("Render map layer: %s", layer_name);
+                    //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
+                    return NG_ERROR;
                 }
+                count_draw(core->map->sprite[draw->sprite_id - 1].texture, &draw->dst, core);
             }
         }
-        layer = layer->next;
+
+        if (snapshot->debug_mode)
+        {
+            if (draw->is_debug_solid)
+            {
+                SDL_SetRenderDrawColor(core->renderer, 0xff, 0x00, 0x00, 0x00);
+            }
+            else
+            {
+                SDL_SetRenderDrawColor(core->renderer, 0x00, 0xff, 0x00, 0x00);
+            }
+            SDL_RenderDrawRect(core->renderer, &draw->debug_frame);
+            count_stat(STAT_DRAWS, 1, core);
+        }
     }
 
-    if (0 > SDL_SetRenderTarget(core->renderer, core->render_target))
+    end_profile(PROF_SCENE, start, core);
+
+    start = begin_profile();
+
+    if (snapshot->has_text)
     {
-        //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
-        return NG_ERROR;
+        render_text(snapshot->display_text, core);
     }
 
-    return NG_OK;
+    if (snapshot->debug_mode)
+    {
+        render_debug_text(snapshot->debug_text, 0, 0, core);
+    }
+
+    end_profile(PROF_TEXT, start, core);
+
+    start  = begin_profile();
+    status = draw_scene(SDL_TRUE, core);
+    end_profile(PROF_PRESENT, start, core);
+
+    return status;
 }
 
 // https://github.com/ngagesdk/nrpg/issues/2
@@ -1216,11 +1644,11 @@ status_t render_scene_ex(ngine_t* core)
 
     if (! core->map->layer_texture)
     {
-        core->map->layer_texture = SDL_CreateTexture(
-            core->renderer,
+        core->map->layer_texture = create_texture(
             SDL_PIXELFORMAT_RGB444,
             SDL_TEXTUREACCESS_TARGET,
-            256, 256);
+            256, 256,
+            core);
 
         if (! core->map->layer_texture)
         {
@@ -1236,7 +1664,7 @@ exit:
     return status;
 }
 
-status_t draw_scene(ngine_t* core)
+status_t draw_scene(SDL_bool is_map_loaded, ngine_t* core)
 {
     SDL_Rect dst = { 0, 0, 176, 208 };
 
@@ -1245,26 +1673,38 @@ status_t draw_scene(ngine_t* core)
         //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
     }
 
-    if (! core->is_map_loaded)
+    if (! is_map_loaded)
     {
         SDL_SetRenderDrawColor(core->renderer, 0x22, 0x33, 0x44, 0x00);
         SDL_RenderClear(core->renderer);
+        count_draw(NULL, NULL, core);
         //set_display_text("Loading", core);
-        //render_text(core);
+        //render_text("Loading", core);
         SDL_RenderPresent(core->renderer);
 
         return NG_OK;
     }
 
+    // The scene has already been composed into the backbuffer.  The
+    // layer texture covers the entire viewport, so there is no need to
+    // clear it either.
+    if (! core->use_render_target)
+    {
+        SDL_RenderPresent(core->renderer);
+        return NG_OK;
+    }
+
     if (0 > SDL_RenderCopy(core->renderer, core->render_target, NULL, &dst))
     {
         //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
         return NG_ERROR;
     }
+    count_draw(core->render_target, &dst, core);
 
     SDL_SetRenderDrawColor(core->renderer, 0x00, 0x00, 0x00, 0x00);
     SDL_RenderPresent(core->renderer);
     SDL_RenderClear(core->renderer);
+    count_draw(NULL, NULL, core);
 
     return NG_OK;
 }
@@ -1279,16 +1719,9 @@ void restrict_camera(ngine_t* core)
     core->camera.pos_x = SDL_clamp(core->camera.pos_x, 0, core->map->width  - 176);
     core->camera.pos_y = SDL_clamp(core->camera.pos_y, 0, core->map->height - 208);
 
-    if (core->map->active_entity)
+    if (core->map->active_entity && get_entity_index(core->map->active_entity, core) < 0)
     {
-        if (core->map->active_entity < 1)
-        {
-            core->map->active_entity = core->map->entity_count;
-        }
-        else if (core->map->active_entity > core->map->entity_count)
-        {
-            core->map->active_entity = 1;
-        }
+        core->map->active_entity = get_entity_handle(0, core);
     }
 }
 
@@ -1303,12 +1736,20 @@ void update_camera(ngine_t* core)
     {
         if (core->map->active_entity)
         {
-            entity_t* target = &core->map->entity[core->map->active_entity - 1];
+            Sint32 target = get_entity_index(core->map->active_entity, core);
 
-            core->camera.pos_x  = target->pos_x;
-            core->camera.pos_x -= 88;  // 176 / 2
-            core->camera.pos_y  = target->pos_y;
-            core->camera.pos_y -= 104; // 208 / 2
+            // The entity has been despawned: the camera stays put.
+            if (0 > target)
+            {
+                core->map->active_entity = 0;
+            }
+            else
+            {
+                core->camera.pos_x  = core->map->entity.pos_x[target];
+                core->camera.pos_x -= 88;  // 176 / 2
+                core->camera.pos_y  = core->map->entity.pos_y[target];
+                core->camera.pos_y -= 104; // 208 / 2
+            }
         }
 
         if (core->camera.pos_x < 0)
@@ -1331,9 +1772,14 @@ status_t load_map_right(const char* map_name, Sint32 pos_y, ngine_t* core)
         return status;
     }
 
-    player_index                          = core->map->active_entity - 1;
-    core->map->entity[player_index].pos_x = (core->map->entity[player_index].width / 2);
-    core->map->entity[player_index].pos_y = pos_y;
+    // The new map may not have a player.
+    player_index = get_entity_index(core->map->active_entity, core);
+    if (0 > player_index)
+    {
+        return status;
+    }
+
+    set_entity_position(core->map->active_entity, (core->map->entity.render[player_index].width / 2), pos_y, core);
 
     return status;
 }
@@ -1349,9 +1795,14 @@ status_t load_map_left(const char* map_name, Sint32 pos_y, ngine_t* core)
         return status;
     }
 
-    player_index                          = core->map->active_entity - 1;
-    core->map->entity[player_index].pos_x = core->map->width - (core->map->entity[player_index].width / 2);
-    core->map->entity[player_index].pos_y = pos_y;
+    // The new map may not have a player.
+    player_index = get_entity_index(core->map->active_entity, core);
+    if (0 > player_index)
+    {
+        return status;
+    }
+
+    set_entity_position(core->map->active_entity, core->map->width - (core->map->entity.render[player_index].width / 2), pos_y, core);
 
     return status;
 }
@@ -1359,7 +1810,6 @@ status_t load_map_left(const char* map_name, Sint32 pos_y, ngine_t* core)
 status_t load_map_down(const char* map_name, Sint32 pos_x, ngine_t* core)
 {
     status_t status = NG_OK;
-    Sint32   player_index;
 
     status = ng_load_map(map_name, core);
     if (NG_OK != status)
@@ -1367,9 +1817,7 @@ status_t load_map_down(const char* map_name, Sint32 pos_x, ngine_t* core)
         return status;
     }
 
-    player_index                          = core->map->active_entity - 1;
-    core->map->entity[player_index].pos_x = pos_x;
-    core->map->entity[player_index].pos_y = 0;
+    set_entity_position(core->map->active_entity, pos_x, 0, core);
 
     return status;
 }
@@ -1385,51 +1833,81 @@ status_t load_map_up(const char* map_name, Sint32 pos_x, ngine_t* core)
         return status;
     }
 
-    player_index                          = core->map->active_entity - 1;
-    core->map->entity[player_index].pos_x = pos_x;
-    core->map->entity[player_index].pos_y = core->map->height - (core->map->entity[player_index].height / 2);
+    // The new map may not have a player.
+    player_index = get_entity_index(core->map->active_entity, core);
+    if (0 > player_index)
+    {
+        return status;
+    }
+
+    set_entity_position(core->map->active_entity, pos_x, core->map->height - (core->map->entity.render[player_index].height / 2), core);
 
     return status;
 }
 
-void move_entity(entity_t* entity, Sint32 offset_x, Sint32 offset_y, ngine_t* core)
+void move_entity(entity_handle_t handle, Sint32 offset_x, Sint32 offset_y, ngine_t* core)
 {
-    Sint32 tile_index;
-    Sint32 adjacent_tile;
+    Sint32           index = get_entity_index(handle, core);
+    Sint32*          pos_x;
+    Sint32*          pos_y;
+    entity_render_t* render;
 
     if (! is_map_loaded(core))
     {
         return;
     }
 
-    if (core->display_text)
+    if ('\0' != core->display_text[0])
     {
         return;
     }
 
-    tile_index = get_tile_index(entity->pos_x, entity->pos_y, core);
+    if (0 > index)
+    {
+        return;
+    }
 
-    // Moves right.
-    if (offset_x > 0)
+    pos_x  = &core->map->entity.pos_x[index];
+    pos_y  = &core->map->entity.pos_y[index];
+    render = &core->map->entity.render[index];
+
+    // Only the player is able to trigger a map transition.
+    if (handle != core->map->active_entity)
     {
-        adjacent_tile = tile_index + 1;
-        if (! core->map->tile_desc[adjacent_tile].is_solid)
+        if (offset_x)
         {
-            entity->pos_x += offset_x;
+            *pos_x += sweep_entity_x(index, offset_x, core);
         }
-        else if((entity->pos_x / get_tile_width(core->map->handle)) >= (core->map->handle->width - 1))
+        if (offset_y)
         {
-            entity->pos_x += offset_x;
+            *pos_y += sweep_entity_y(index, offset_y, core);
+            mark_draw_order_dirty(core);
         }
+        update_grid_entity(index, core);
+        update_trigger_entity(index, core);
+        return;
+    }
 
-        if (entity->pos_x >= (core->map->width + (entity->width / 2)))
+    // Resolve each axis separately, so that entities slide along walls.
+    if (offset_x)
+    {
+        *pos_x += sweep_entity_x(index, offset_x, core);
+    }
+
+    // Moves right.
+    if (offset_x > 0)
+    {
+        if (*pos_x >= (core->map->width + (render->width / 2)))
         {
-            if (get_string_map_property(H_map_right, core))
+            const char* next_map = get_string_map_property(H_map_right, core);
+
+            if (next_map)
             {
-                char map_name[16] = { 0 };
-                stbsp_snprintf(map_name, 16, "%s", core->map->string_property);
+                char   map_name[16] = { 0 };
+                Sint32 pos          = *pos_y;
+                stbsp_snprintf(map_name, 16, "%s", next_map);
                 ng_unload_map(core);
-                load_map_right(map_name, entity->pos_y, core);
+                load_map_right(map_name, pos, core);
                 return;
             }
         }
@@ -1437,55 +1915,41 @@ void move_entity(entity_t* entity, Sint32 offset_x, Sint32 offset_y, ngine_t* co
     // Moves left.
     else if (offset_x < 0)
     {
-        adjacent_tile = tile_index - 1;
-        if (! core->map->tile_desc[adjacent_tile].is_solid)
+        if (*pos_x <= (0 - (render->width / 2)))
         {
-            entity->pos_x += offset_x;
-        }
-        else if((entity->pos_x / get_tile_width(core->map->handle)) <= 0)
-        {
-            entity->pos_x += offset_x;
-        }
+            const char* next_map = get_string_map_property(H_map_left, core);
 
-        if (entity->pos_x <= (0 - (entity->width / 2)))
-        {
-            if (get_string_map_property(H_map_left, core))
+            if (next_map)
             {
-                char map_name[16] = { 0 };
-                stbsp_snprintf(map_name, 16, "%s", core->map->string_property);
+                char   map_name[16] = { 0 };
+                Sint32 pos          = *pos_y;
+                stbsp_snprintf(map_name, 16, "%s", next_map);
                 ng_unload_map(core);
-                load_map_left(map_name, entity->pos_y, core);
+                load_map_left(map_name, pos, core);
                 return;
             }
         }
     }
 
+    if (offset_y)
+    {
+        *pos_y += sweep_entity_y(index, offset_y, core);
+    }
+
     // Moves down.
     if (offset_y > 0)
     {
-        adjacent_tile = tile_index + core->map->handle->width;
-        if (adjacent_tile >= core->map->tile_desc_count)
-        {
-            adjacent_tile = core->map->tile_desc_count - 1;
-        }
-
-        if (! core->map->tile_desc[adjacent_tile].is_solid)
+        if (*pos_y >= (core->map->height + (render->height / 2)))
         {
-            entity->pos_y += offset_y;
-        }
-        else if((entity->pos_y / get_tile_height(core->map->handle)) >= (core->map->handle->height - 1))
-        {
-            entity->pos_y += offset_y;
-        }
+            const char* next_map = get_string_map_property(H_map_down, core);
 
-        if (entity->pos_y >= (core->map->height + (entity->height / 2)))
-        {
-            if (get_string_map_property(H_map_down, core))
+            if (next_map)
             {
-                char map_name[16] = { 0 };
-                stbsp_snprintf(map_name, 16, "%s", core->map->string_property);
+                char   map_name[16] = { 0 };
+                Sint32 pos          = *pos_x;
+                stbsp_snprintf(map_name, 16, "%s", next_map);
                 ng_unload_map(core);
-                load_map_down(map_name, entity->pos_x, core);
+                load_map_down(map_name, pos, core);
                 return;
             }
         }
@@ -1493,29 +1957,27 @@ void move_entity(entity_t* entity, Sint32 offset_x, Sint32 offset_y, ngine_t* co
     // Moves up.
     else if (offset_y < 0)
     {
-        adjacent_tile = tile_index - core->map->handle->width;
-        if (adjacent_tile >= 0)
-        {
-            if (! core->map->tile_desc[adjacent_tile].is_solid)
-            {
-                entity->pos_y += offset_y;
-            }
-        }
-        else
+        if (*pos_y <= (0 - (render->height / 2)))
         {
-            entity->pos_y += offset_y;
-        }
+            const char* next_map = get_string_map_property(H_map_up, core);
 
-        if (entity->pos_y <= (0 - (entity->height / 2)))
-        {
-            if (get_string_map_property(H_map_up, core))
+            if (next_map)
             {
-                char map_name[16] = { 0 };
-                stbsp_snprintf(map_name, 16, "%s", core->map->string_property);
+                char   map_name[16] = { 0 };
+                Sint32 pos          = *pos_x;
+                stbsp_snprintf(map_name, 16, "%s", next_map);
                 ng_unload_map(core);
-                load_map_up(map_name, entity->pos_x, core);
+                load_map_up(map_name, pos, core);
                 return;
             }
         }
     }
+
+    update_grid_entity(index, core);
+    update_trigger_entity(index, core);
+
+    if (offset_y)
+    {
+        mark_draw_order_dirty(core);
+    }
 }
@@ -0,0 +1,229 @@
+/** @file depth.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Persistent y-sorted draw order for entities.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include "ngine.h"
+
+static Uint16 get_depth_key(Sint32 index, ngine_t* core)
+{
+    Sint32 key = core->map->entity.pos_y[index] + (core->map->entity.render[index].height / 2) + NG_DEPTH_BIAS;
+
+    return (Uint16)SDL_clamp(key, 0, 0xffff);
+}
+
+// Entities only move a few pixels per frame, so the draw order of the
+// previous frame is nearly sorted and insertion sort runs in close to
+// linear time.
+static void insertion_sort_draw_order(ngine_t* core)
+{
+    depth_order_t* depth = &core->map->depth;
+    Sint32         index;
+
+    for (index = 1; index < depth->count; index += 1)
+    {
+        Sint32 current = depth->order[index];
+        Uint16 key     = get_depth_key(current, core);
+        Sint32 pos     = index - 1;
+
+        while (pos >= 0 && get_depth_key(depth->order[pos], core) > key)
+        {
+            depth->order[pos + 1] = depth->order[pos];
+            pos -= 1;
+        }
+        depth->order[pos + 1] = current;
+    }
+}
+
+// Stable LSD radix sort on the 16-bit depth key, used when the order has
+// to be rebuilt or a large share of entities has moved.
+static void radix_sort_draw_order(ngine_t* core)
+{
+    depth_order_t* depth = &core->map->depth;
+    Sint32         count[256];
+    Sint32*        src   = depth->order;
+    Sint32*        dst   = depth->scratch;
+    Sint32         shift;
+    Sint32         index;
+
+    for (shift = 0; shift < 16; shift += 8)
+    {
+        Sint32  offset = 0;
+        Sint32* swap;
+
+        SDL_memset(count, 0, sizeof(count));
+
+        for (index = 0; index < depth->count; index += 1)
+        {
+            count[(get_depth_key(src[index], core) >> shift) & 0xff] += 1;
+        }
+
+        for (index = 0; index < 256; index += 1)
+        {
+            Sint32 bucket_size = count[index];
+
+            count[index]  = offset;
+            offset       += bucket_size;
+        }
+
+        for (index = 0; index < depth->count; index += 1)
+        {
+            Sint32 bucket = (get_depth_key(src[index], core) >> shift) & 0xff;
+
+            dst[count[bucket]]  = src[index];
+            count[bucket]      += 1;
+        }
+
+        swap = src;
+        src  = dst;
+        dst  = swap;
+    }
+
+    // After an even number of passes, the result is back in order[].
+}
+
+static void update_draw_rank(ngine_t* core)
+{
+    depth_order_t* depth = &core->map->depth;
+    Sint32         index;
+
+    for (index = 0; index < depth->count; index += 1)
+    {
+        depth->rank[depth->order[index]] = index;
+    }
+}
+
+status_t init_draw_order(ngine_t* core)
+{
+    depth_order_t* depth = &core->map->depth;
+    Sint32         index;
+
+    depth->count    = core->map->entity_count;
+    depth->capacity = core->map->entity.capacity;
+
+    if (0 >= depth->capacity)
+    {
+        return NG_OK;
+    }
+
+    // Sized for the entire pool, so that spawning never allocates.
+    depth->order = (Sint32*)calloc_memory((size_t)depth->capacity * 3, sizeof(Sint32), MEM_MAP, core);
+    if (! depth->order)
+    {
+        //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+        return NG_ERROR;
+    }
+    depth->scratch = depth->order   + depth->capacity;
+    depth->rank    = depth->scratch + depth->capacity;
+
+    for (index = 0; index < depth->count; index += 1)
+    {
+        depth->order[index] = index;
+    }
+
+    radix_sort_draw_order(core);
+    update_draw_rank(core);
+
+    return NG_OK;
+}
+
+void free_draw_order(ngine_t* core)
+{
+    free_memory(core->map->depth.order, core);
+    SDL_memset(&core->map->depth, 0, sizeof(struct depth_order));
+}
+
+// Spawned entities are appended and sorted into place by the next
+// update, the same way as entities that have moved.
+void add_draw_order(Sint32 index, ngine_t* core)
+{
+    depth_order_t* depth = &core->map->depth;
+
+    if (depth->count >= depth->capacity)
+    {
+        return;
+    }
+
+    depth->order[depth->count]  = index;
+    depth->rank[index]          = depth->count;
+    depth->count               += 1;
+    depth->moved_count         += 1;
+}
+
+// The last entry takes the place of the removed one.
+void remove_draw_order(Sint32 index, ngine_t* core)
+{
+    depth_order_t* depth = &core->map->depth;
+    Sint32         pos;
+    Sint32         last;
+
+    if (0 >= depth->count)
+    {
+        return;
+    }
+
+    pos  = depth->rank[index];
+    last = depth->order[depth->count - 1];
+
+    depth->order[pos]   = last;
+    depth->rank[last]   = pos;
+    depth->count       -= 1;
+    depth->moved_count += 1;
+}
+
+void mark_draw_order_dirty(ngine_t* core)
+{
+    core->map->depth.moved_count += 1;
+}
+
+void update_draw_order(ngine_t* core)
+{
+    depth_order_t* depth = &core->map->depth;
+
+    if (0 == depth->moved_count)
+    {
+        return;
+    }
+
+    if (depth->count > NG_DEPTH_RADIX_THRESHOLD && depth->moved_count > (depth->count / 8))
+    {
+        radix_sort_draw_order(core);
+    }
+    else
+    {
+        insertion_sort_draw_order(core);
+    }
+
+    update_draw_rank(core);
+    depth->moved_count = 0;
+}
+
+// Sorts a subset of entities, e.g. the ones returned by a grid query, by
+// their rank in the persistent draw order.  Grid queries return cells
+// row by row, so the list is nearly sorted already.
+void sort_by_draw_order(Sint32* list, Sint32 count, ngine_t* core)
+{
+    Sint32* rank = core->map->depth.rank;
+    Sint32  index;
+
+    for (index = 1; index < count; index += 1)
+    {
+        Sint32 current = list[index];
+        Sint32 pos     = index - 1;
+
+        while (pos >= 0 && rank[list[pos]] > rank[current])
+        {
+            list[pos + 1] = list[pos];
+            pos -= 1;
+        }
+        list[pos + 1] = current;
+    }
+}
@@ -0,0 +1,270 @@
+/** @file entity.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Entity storage (structure of arrays) and handle API.  The store is a
+ *  pool of fixed capacity: despawned slots go onto a free list and are
+ *  reused by later spawns, so that no memory is allocated after a map
+ *  has been loaded.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include "ngine.h"
+
+status_t alloc_entities(Sint32 count, ngine_t* core)
+{
+    entity_store_t* store = &core->map->entity;
+
+    SDL_memset(store, 0, sizeof(struct entity_store));
+    store->free_head = -1;
+
+    if (0 >= count)
+    {
+        return NG_OK;
+    }
+
+    // Hot columns first: they are iterated every frame.
+    store->pos_x     = (Sint32*)calloc_memory((size_t)count, sizeof(Sint32), MEM_ENTITY, core);
+    store->pos_y     = (Sint32*)calloc_memory((size_t)count, sizeof(Sint32), MEM_ENTITY, core);
+    store->state     = (Uint32*)calloc_memory((size_t)count, sizeof(Uint32), MEM_ENTITY, core);
+    store->animation = (animation_t*)calloc_memory((size_t)count, sizeof(struct animation), MEM_ENTITY, core);
+    store->render    = (entity_render_t*)calloc_memory((size_t)count, sizeof(struct entity_render), MEM_ENTITY, core);
+    store->body      = (entity_body_t*)calloc_memory((size_t)count, sizeof(struct entity_body), MEM_ENTITY, core);
+    store->brain     = (entity_brain_t*)calloc_memory((size_t)count, sizeof(struct entity_brain), MEM_ENTITY, core);
+    store->motion    = (entity_motion_t*)calloc_memory((size_t)count, sizeof(struct entity_motion), MEM_ENTITY, core);
+    store->handle    = (cute_tiled_object_t**)calloc_memory((size_t)count, sizeof(cute_tiled_object_t*), MEM_ENTITY, core);
+    store->uid       = (Sint32*)calloc_memory((size_t)count, sizeof(Sint32), MEM_ENTITY, core);
+
+    // Pool bookkeeping.
+    store->generation = (Uint16*)calloc_memory((size_t)count, sizeof(Uint16), MEM_ENTITY, core);
+    store->next_free  = (Sint32*)calloc_memory((size_t)count, sizeof(Sint32), MEM_ENTITY, core);
+    store->is_alive   = (SDL_bool*)calloc_memory((size_t)count, sizeof(SDL_bool), MEM_ENTITY, core);
+
+    if (! store->pos_x || ! store->pos_y || ! store->state || ! store->animation || ! store->render || ! store->body || ! store->brain || ! store->motion || ! store->handle || ! store->uid)
+    {
+        //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+        free_entities(core);
+        return NG_ERROR;
+    }
+
+    if (! store->generation || ! store->next_free || ! store->is_alive)
+    {
+        //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+        free_entities(core);
+        return NG_ERROR;
+    }
+
+    store->capacity = count;
+
+    return NG_OK;
+}
+
+void free_entities(ngine_t* core)
+{
+    entity_store_t* store = &core->map->entity;
+
+    free_memory(store->pos_x, core);
+    free_memory(store->pos_y, core);
+    free_memory(store->state, core);
+    free_memory(store->animation, core);
+    free_memory(store->render, core);
+    free_memory(store->body, core);
+    free_memory(store->brain, core);
+    free_memory(store->motion, core);
+    free_memory(store->handle, core);
+    free_memory(store->uid, core);
+    free_memory(store->generation, core);
+    free_memory(store->next_free, core);
+    free_memory(store->is_alive, core);
+
+    SDL_memset(store, 0, sizeof(struct entity_store));
+}
+
+entity_handle_t get_entity_handle(Sint32 index, ngine_t* core)
+{
+    entity_store_t* store = &core->map->entity;
+
+    if (0 > index || index >= core->map->entity_count || ! store->is_alive[index])
+    {
+        return 0;
+    }
+
+    return ((entity_handle_t)store->generation[index] << NG_ENTITY_INDEX_BITS) | (entity_handle_t)(index + 1);
+}
+
+// Returns -1 for handles of entities that have been despawned.
+Sint32 get_entity_index(entity_handle_t handle, ngine_t* core)
+{
+    entity_store_t* store = &core->map->entity;
+    Sint32          index = (Sint32)(handle & NG_ENTITY_INDEX_MASK) - 1;
+
+    if (0 > index || index >= core->map->entity_count || ! store->is_alive[index])
+    {
+        return -1;
+    }
+
+    if (store->generation[index] != (Uint16)(handle >> NG_ENTITY_INDEX_BITS))
+    {
+        return -1;
+    }
+
+    return index;
+}
+
+// Slots are handed out in order while loading and taken from the free
+// list afterwards.
+static Sint32 take_entity_slot(ngine_t* core)
+{
+    entity_store_t* store = &core->map->entity;
+    Sint32          index;
+
+    if (0 <= store->free_head)
+    {
+        index            = store->free_head;
+        store->free_head = store->next_free[index];
+    }
+    else if (core->map->entity_count < store->capacity)
+    {
+        index                    = core->map->entity_count;
+        core->map->entity_count += 1;
+    }
+    else
+    {
+        return -1;
+    }
+
+    store->next_free[index]  = -1;
+    store->is_alive[index]   = SDL_TRUE;
+    store->live_count       += 1;
+
+    return index;
+}
+
+// Used by the loader; the entity is initialised by the caller.
+Sint32 add_entity(ngine_t* core)
+{
+    return take_entity_slot(core);
+}
+
+// Spawns a copy of the given entity, e.g. one placed on the map as a
+// template for projectiles.  Runs in constant time and never allocates.
+// Returns 0 if the pool is exhausted.
+entity_handle_t ng_spawn_entity(entity_handle_t prototype, Sint32 pos_x, Sint32 pos_y, ngine_t* core)
+{
+    entity_store_t*  store;
+    entity_motion_t* motion;
+    Sint32           source;
+    Sint32           index;
+
+    if (! core->is_map_loaded)
+    {
+        return 0;
+    }
+
+    source = get_entity_index(prototype, core);
+    if (0 > source)
+    {
+        return 0;
+    }
+
+    index = take_entity_slot(core);
+    if (0 > index)
+    {
+        //SDL_Log("%s: entity pool exhausted.", FUNCTION_NAME);
+        return 0;
+    }
+
+    store                   = &core->map->entity;
+    store->pos_x[index]     = pos_x;
+    store->pos_y[index]     = pos_y;
+    store->state[index]     = store->state[source];
+    store->animation[index] = store->animation[source];
+    store->render[index]    = store->render[source];
+    store->body[index]      = store->body[source];
+    store->brain[index]     = store->brain[source];
+    store->motion[index]    = store->motion[source];
+    store->handle[index]    = store->handle[source];
+    store->uid[index]       = 0;
+
+    // Spawned entities start at rest and are due right away.
+    motion             = &store->motion[index];
+    motion->vel_x      = 0;
+    motion->vel_y      = 0;
+    motion->frac_x     = 0;
+    motion->frac_y     = 0;
+    motion->input_x    = 0;
+    motion->input_y    = 0;
+    motion->wants_jump = SDL_FALSE;
+
+    store->brain[index].next_update = core->map->scheduler.time;
+
+    insert_grid_entity(index, core);
+    add_draw_order(index, core);
+
+    return get_entity_handle(index, core);
+}
+
+// Runs in constant time.  The handle and all copies of it become stale.
+void ng_despawn_entity(entity_handle_t handle, ngine_t* core)
+{
+    entity_store_t* store;
+    Sint32          index;
+
+    if (! core->is_map_loaded)
+    {
+        return;
+    }
+
+    index = get_entity_index(handle, core);
+    if (0 > index)
+    {
+        return;
+    }
+
+    remove_grid_entity(index, core);
+    remove_draw_order(index, core);
+    remove_trigger_entity(index, core);
+
+    store = &core->map->entity;
+
+    // Keeps the per-frame loops from picking the slot up.
+    store->motion[index].is_enabled = SDL_FALSE;
+    store->brain[index].behaviour   = B_NONE;
+
+    store->is_alive[index]    = SDL_FALSE;
+    store->generation[index] += 1;
+    store->next_free[index]   = store->free_head;
+    store->free_head          = index;
+    store->live_count        -= 1;
+
+    if (handle == core->map->active_entity)
+    {
+        core->map->active_entity = 0;
+    }
+}
+
+void set_entity_position(entity_handle_t handle, Sint32 pos_x, Sint32 pos_y, ngine_t* core)
+{
+    Sint32 index = get_entity_index(handle, core);
+
+    if (0 > index)
+    {
+        return;
+    }
+
+    if (pos_y != core->map->entity.pos_y[index])
+    {
+        mark_draw_order_dirty(core);
+    }
+
+    core->map->entity.pos_x[index] = pos_x;
+    core->map->entity.pos_y[index] = pos_y;
+
+    update_grid_entity(index, core);
+    update_trigger_entity(index, core);
+}
@@ -0,0 +1,261 @@
+/** @file grid.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Uniform spatial grid used for entity culling and neighbourhood
+ *  queries.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include "ngine.h"
+
+static Sint32 get_grid_cell(Sint32 pos_x, Sint32 pos_y, spatial_grid_t* grid)
+{
+    Sint32 col = pos_x / grid->cell_size;
+    Sint32 row = pos_y / grid->cell_size;
+
+    // Entities may leave the map during a transition.
+    col = SDL_clamp(col, 0, grid->cols - 1);
+    row = SDL_clamp(row, 0, grid->rows - 1);
+
+    return (row * grid->cols) + col;
+}
+
+static void unlink_grid_entity(Sint32 index, spatial_grid_t* grid)
+{
+    Sint32 cell = grid->cell[index];
+
+    if (0 > cell)
+    {
+        return;
+    }
+
+    if (0 <= grid->prev[index])
+    {
+        grid->next[grid->prev[index]] = grid->next[index];
+    }
+    else
+    {
+        grid->cell_head[cell] = grid->next[index];
+    }
+
+    if (0 <= grid->next[index])
+    {
+        grid->prev[grid->next[index]] = grid->prev[index];
+    }
+
+    grid->cell[index] = -1;
+    grid->next[index] = -1;
+    grid->prev[index] = -1;
+}
+
+static void link_grid_entity(Sint32 index, Sint32 cell, spatial_grid_t* grid)
+{
+    grid->cell[index] = cell;
+    grid->prev[index] = -1;
+    grid->next[index] = grid->cell_head[cell];
+
+    if (0 <= grid->cell_head[cell])
+    {
+        grid->prev[grid->cell_head[cell]] = index;
+    }
+    grid->cell_head[cell] = index;
+}
+
+status_t init_grid(ngine_t* core)
+{
+    spatial_grid_t* grid = &core->map->grid;
+    Sint32          tile_size;
+    Sint32          index;
+
+    tile_size       = SDL_max(get_tile_width(core->map->handle), get_tile_height(core->map->handle));
+    grid->cell_size = tile_size * NG_GRID_CELL_TILES;
+    grid->cols      = (core->map->width  + grid->cell_size - 1) / grid->cell_size;
+    grid->rows      = (core->map->height + grid->cell_size - 1) / grid->cell_size;
+    grid->capacity  = core->map->entity.capacity;
+
+    if (0 >= grid->cols || 0 >= grid->rows)
+    {
+        grid->cols = 1;
+        grid->rows = 1;
+    }
+
+    grid->cell_head = (Sint32*)alloc_memory((size_t)(grid->cols * grid->rows) * sizeof(Sint32), MEM_MAP, core);
+    if (! grid->cell_head)
+    {
+        //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+        return NG_ERROR;
+    }
+    SDL_memset(grid->cell_head, 0xff, (size_t)(grid->cols * grid->rows) * sizeof(Sint32));
+
+    if (0 >= grid->capacity)
+    {
+        return NG_OK;
+    }
+
+    // One block for all per-entity arrays: cell, next, prev and the
+    // query result buffer.
+    grid->cell = (Sint32*)alloc_memory((size_t)grid->capacity * 4 * sizeof(Sint32), MEM_MAP, core);
+    if (! grid->cell)
+    {
+        //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+        return NG_ERROR;
+    }
+    grid->next   = grid->cell + grid->capacity;
+    grid->prev   = grid->next + grid->capacity;
+    grid->result = grid->prev + grid->capacity;
+
+    SDL_memset(grid->cell, 0xff, (size_t)grid->capacity * 3 * sizeof(Sint32));
+
+    for (index = 0; index < core->map->entity_count; index += 1)
+    {
+        insert_grid_entity(index, core);
+    }
+
+    return NG_OK;
+}
+
+// Adds a spawned entity to the grid.
+void insert_grid_entity(Sint32 index, ngine_t* core)
+{
+    spatial_grid_t*  grid   = &core->map->grid;
+    entity_render_t* render;
+    entity_body_t*   body;
+
+    if (0 > index || index >= grid->capacity)
+    {
+        return;
+    }
+
+    render = &core->map->entity.render[index];
+    body   = &core->map->entity.body[index];
+
+    grid->max_extent_x = SDL_max(grid->max_extent_x, SDL_max(render->width,  body->width)  / 2);
+    grid->max_extent_y = SDL_max(grid->max_extent_y, SDL_max(render->height, body->height) / 2);
+
+    unlink_grid_entity(index, grid);
+    link_grid_entity(index, get_grid_cell(core->map->entity.pos_x[index], core->map->entity.pos_y[index], grid), grid);
+}
+
+// Removes a despawned entity from the grid.
+void remove_grid_entity(Sint32 index, ngine_t* core)
+{
+    spatial_grid_t* grid = &core->map->grid;
+
+    if (0 > index || index >= grid->capacity)
+    {
+        return;
+    }
+
+    unlink_grid_entity(index, grid);
+}
+
+void free_grid(ngine_t* core)
+{
+    spatial_grid_t* grid = &core->map->grid;
+
+    free_memory(grid->cell_head, core);
+    free_memory(grid->cell, core);
+    SDL_memset(grid, 0, sizeof(struct spatial_grid));
+}
+
+void update_grid_entity(Sint32 index, ngine_t* core)
+{
+    spatial_grid_t* grid = &core->map->grid;
+    Sint32          cell;
+
+    if (0 > index || index >= grid->capacity)
+    {
+        return;
+    }
+
+    // Despawned entities stay out of the grid.
+    if (0 > grid->cell[index])
+    {
+        return;
+    }
+
+    cell = get_grid_cell(core->map->entity.pos_x[index], core->map->entity.pos_y[index], grid);
+
+    if (cell == grid->cell[index])
+    {
+        return;
+    }
+
+    unlink_grid_entity(index, grid);
+    link_grid_entity(index, cell, grid);
+}
+
+Sint32 query_grid_rect(Sint32 pos_x, Sint32 pos_y, Sint32 width, Sint32 height, Sint32* result, Sint32 max_results, ngine_t* core)
+{
+    spatial_grid_t* grid        = &core->map->grid;
+    Sint32          first_col;
+    Sint32          first_row;
+    Sint32          last_col;
+    Sint32          last_row;
+    Sint32          col;
+    Sint32          row;
+    Sint32          count       = 0;
+
+    if (! grid->cell_head || 0 >= grid->capacity)
+    {
+        return 0;
+    }
+
+    // Entities are stored by their centre, so the query has to be
+    // padded by the largest half-extent to catch overlapping ones.
+    first_col = SDL_clamp((pos_x - grid->max_extent_x) / grid->cell_size, 0, grid->cols - 1);
+    first_row = SDL_clamp((pos_y - grid->max_extent_y) / grid->cell_size, 0, grid->rows - 1);
+    last_col  = SDL_clamp((pos_x + width  + grid->max_extent_x) / grid->cell_size, 0, grid->cols - 1);
+    last_row  = SDL_clamp((pos_y + height + grid->max_extent_y) / grid->cell_size, 0, grid->rows - 1);
+
+    for (row = first_row; row <= last_row; row += 1)
+    {
+        for (col = first_col; col <= last_col; col += 1)
+        {
+            Sint32 index = grid->cell_head[(row * grid->cols) + col];
+
+            while (0 <= index)
+            {
+                if (count >= max_results)
+                {
+                    return count;
+                }
+
+                result[count]  = index;
+                count         += 1;
+                index          = grid->next[index];
+            }
+        }
+    }
+
+    return count;
+}
+
+Sint32 query_grid_radius(Sint32 pos_x, Sint32 pos_y, Sint32 radius, Sint32* result, Sint32 max_results, ngine_t* core)
+{
+    Sint32 count;
+    Sint32 index;
+    Sint32 hits  = 0;
+
+    count = query_grid_rect(pos_x - radius, pos_y - radius, radius * 2, radius * 2, result, max_results, core);
+
+    for (index = 0; index < count; index += 1)
+    {
+        Sint32 dist_x = core->map->entity.pos_x[result[index]] - pos_x;
+        Sint32 dist_y = core->map->entity.pos_y[result[index]] - pos_y;
+
+        if (((dist_x * dist_x) + (dist_y * dist_y)) <= (radius * radius))
+        {
+            result[hits]  = result[index];
+            hits         += 1;
+        }
+    }
+
+    return hits;
+}
@@ -0,0 +1,137 @@
+/** @file input.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Input handling.  All pending events are drained once per frame into
+ *  a timestamped ring buffer; key state is exposed as level (down) and
+ *  edge (pressed, released) bit masks.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include "ngine.h"
+
+static Uint32 map_key(SDL_Keycode sym)
+{
+    switch (sym)
+    {
+        case SDLK_UP:
+            return NG_KEY_UP;
+        case SDLK_DOWN:
+            return NG_KEY_DOWN;
+        case SDLK_LEFT:
+            return NG_KEY_LEFT;
+        case SDLK_RIGHT:
+            return NG_KEY_RIGHT;
+        case SDLK_5:
+            return NG_KEY_ACTION;
+        case SDLK_9:
+            return NG_KEY_DEBUG;
+        case SDLK_BACKSPACE:
+            return NG_KEY_EXIT;
+        default:
+            return NG_KEY_OTHER;
+    }
+}
+
+static void push_input_event(Uint32 timestamp, Uint32 key, SDL_bool is_down, input_t* input)
+{
+    input_event_t* event;
+
+    // Drop the oldest event if the simulation does not keep up.
+    if (input->count >= NG_INPUT_QUEUE_SIZE)
+    {
+        input->head   = (input->head + 1) % NG_INPUT_QUEUE_SIZE;
+        input->count -= 1;
+    }
+
+    event            = &input->queue[(input->head + input->count) % NG_INPUT_QUEUE_SIZE];
+    event->timestamp = timestamp;
+    event->key       = key;
+    event->is_down   = is_down;
+    input->count    += 1;
+}
+
+void update_input(ngine_t* core)
+{
+    input_t*  input = &core->input;
+    SDL_Event event;
+
+    input->keys_pressed  = 0;
+    input->keys_released = 0;
+
+    while (SDL_PollEvent(&event))
+    {
+        Uint32 key;
+
+        // During a replay, the keyboard is ignored; the queue is still
+        // drained to keep the window responsive.
+        if (REPLAY_PLAY == core->replay.mode && SDL_QUIT != event.type)
+        {
+            continue;
+        }
+
+        switch (event.type)
+        {
+            case SDL_KEYDOWN:
+                if (event.key.repeat)
+                {
+                    break;
+                }
+                key                  = map_key(event.key.keysym.sym);
+                input->keys_down    |= key;
+                input->keys_pressed |= key;
+                push_input_event(event.key.timestamp, key, SDL_TRUE, input);
+                break;
+            case SDL_KEYUP:
+                key                   = map_key(event.key.keysym.sym);
+                input->keys_down     &= ~key;
+                input->keys_released |= key;
+                push_input_event(event.key.timestamp, key, SDL_FALSE, input);
+                break;
+            case SDL_QUIT:
+                input->keys_pressed |= NG_KEY_EXIT;
+                push_input_event(event.quit.timestamp, NG_KEY_EXIT, SDL_TRUE, input);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+SDL_bool get_input_event(input_event_t* event, ngine_t* core)
+{
+    input_t* input = &core->input;
+
+    if (0 == input->count)
+    {
+        return SDL_FALSE;
+    }
+
+    *event         = input->queue[input->head];
+    input->head    = (input->head + 1) % NG_INPUT_QUEUE_SIZE;
+    input->count  -= 1;
+
+    return SDL_TRUE;
+}
+
+// A key pressed and released within the same frame still counts as
+// held for that frame.
+SDL_bool ng_is_key_down(Uint32 key, ngine_t* core)
+{
+    return ((core->input.keys_down | core->input.keys_pressed) & key) ? SDL_TRUE : SDL_FALSE;
+}
+
+SDL_bool ng_is_key_pressed(Uint32 key, ngine_t* core)
+{
+    return (core->input.keys_pressed & key) ? SDL_TRUE : SDL_FALSE;
+}
+
+SDL_bool ng_is_key_released(Uint32 key, ngine_t* core)
+{
+    return (core->input.keys_released & key) ? SDL_TRUE : SDL_FALSE;
+}
@@ -0,0 +1,381 @@
+/** @file job.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Work-stealing job system.  Jobs are collected into a batch along
+ *  with their dependencies and then run to completion.  Every worker
+ *  owns a deque: it works on its own jobs last in, first out and steals
+ *  the oldest job of another worker once it runs dry.  The calling
+ *  thread works along, so without worker threads (e.g. on the N-Gage)
+ *  the same batch simply runs serially.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include "ngine.h"
+
+#if ! defined __SYMBIAN32__ && ! defined SDL_THREADS_DISABLED
+#define NG_HAS_JOB_WORKERS
+#endif
+
+static void push_job(Sint32 job, job_deque_t* deque)
+{
+    SDL_AtomicLock(&deque->lock);
+
+    // Every job is pushed once per batch, so a deque never overflows.
+    deque->job[deque->tail]  = job;
+    deque->tail             += 1;
+
+    SDL_AtomicUnlock(&deque->lock);
+}
+
+static Sint32 pop_job(job_deque_t* deque)
+{
+    Sint32 job = -1;
+
+    SDL_AtomicLock(&deque->lock);
+
+    if (deque->tail > deque->head)
+    {
+        deque->tail -= 1;
+        job          = deque->job[deque->tail];
+    }
+
+    SDL_AtomicUnlock(&deque->lock);
+
+    return job;
+}
+
+static Sint32 steal_job(job_deque_t* deque)
+{
+    Sint32 job = -1;
+
+    SDL_AtomicLock(&deque->lock);
+
+    if (deque->tail > deque->head)
+    {
+        job          = deque->job[deque->head];
+        deque->head += 1;
+    }
+
+    SDL_AtomicUnlock(&deque->lock);
+
+    return job;
+}
+
+static Sint32 find_job(Sint32 self, job_system_t* jobs)
+{
+    Sint32 deque_count = jobs->worker_count + 1;
+    Sint32 offset;
+    Sint32 job;
+
+    job = pop_job(&jobs->deque[self]);
+    if (0 <= job)
+    {
+        return job;
+    }
+
+    // Start with the neighbour, so that thieves spread out.
+    for (offset = 1; offset < deque_count; offset += 1)
+    {
+        job = steal_job(&jobs->deque[(self + offset) % deque_count]);
+        if (0 <= job)
+        {
+            return job;
+        }
+    }
+
+    return -1;
+}
+
+static void execute_job(Sint32 index, Sint32 self, ngine_t* core)
+{
+    job_system_t* jobs = &core->jobs;
+    job_t*        job  = &jobs->job[index];
+    Sint32        pos;
+
+    // A job whose prerequisite failed is skipped and fails likewise.
+    if (NG_OK == job->status)
+    {
+        Uint64 start = begin_profile();
+
+        job->status = job->function(job->first, job->count, core);
+        trace_event("job", job->name, start, core);
+    }
+
+    for (pos = 0; pos < job->successor_count; pos += 1)
+    {
+        job_t* successor = &jobs->job[job->successor[pos]];
+
+        if (NG_OK != job->status)
+        {
+            successor->status = job->status;
+        }
+
+        // The last prerequisite to finish releases the successor.
+        if (1 == SDL_AtomicAdd(&successor->pending, -1))
+        {
+            push_job(job->successor[pos], &jobs->deque[self]);
+        }
+    }
+
+    SDL_AtomicAdd(&jobs->remaining, -1);
+}
+
+static void work_until_done(Sint32 self, ngine_t* core)
+{
+    job_system_t* jobs = &core->jobs;
+
+    while (0 < SDL_AtomicGet(&jobs->remaining))
+    {
+        Sint32 job = find_job(self, jobs);
+
+        if (0 <= job)
+        {
+            execute_job(job, self, core);
+        }
+        else
+        {
+            // The remaining jobs are in progress or wait for one that is.
+            SDL_Delay(0);
+        }
+    }
+}
+
+#ifdef NG_HAS_JOB_WORKERS
+static int job_worker(void* data)
+{
+    job_worker_t* worker = (job_worker_t*)data;
+    job_system_t* jobs   = &worker->core->jobs;
+
+    for (;;)
+    {
+        SDL_bool quit;
+
+        SDL_LockMutex(jobs->wake_lock);
+        while (! jobs->quit && worker->batch == jobs->batch)
+        {
+            SDL_CondWait(jobs->wake, jobs->wake_lock);
+        }
+        worker->batch = jobs->batch;
+        quit          = jobs->quit;
+        SDL_UnlockMutex(jobs->wake_lock);
+
+        if (quit)
+        {
+            break;
+        }
+
+        work_until_done(worker->index, worker->core);
+    }
+
+    return 0;
+}
+#endif
+
+// Starts one worker per additional CPU core.  If that fails for
+// whatever reason, jobs are run serially by the calling thread.
+status_t init_jobs(ngine_t* core)
+{
+#ifdef NG_HAS_JOB_WORKERS
+    job_system_t* jobs  = &core->jobs;
+    Sint32        count = SDL_clamp(SDL_GetCPUCount() - 1, 0, NG_MAX_JOB_WORKERS);
+    Sint32        index;
+
+    if (0 >= count)
+    {
+        return NG_OK;
+    }
+
+    jobs->wake_lock = SDL_CreateMutex();
+    jobs->wake      = SDL_CreateCond();
+
+    if (! jobs->wake_lock || ! jobs->wake)
+    {
+        //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
+        free_jobs(core);
+        return NG_WARNING;
+    }
+
+    for (index = 0; index < count; index += 1)
+    {
+        job_worker_t* worker = &jobs->worker[index];
+
+        worker->core   = core;
+        worker->index  = index + 1;
+        worker->batch  = jobs->batch;
+        worker->thread = SDL_CreateThread(job_worker, "job", worker);
+
+        if (! worker->thread)
+        {
+            //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
+            return NG_WARNING;
+        }
+
+        jobs->worker_count += 1;
+    }
+#endif
+
+    return NG_OK;
+}
+
+void free_jobs(ngine_t* core)
+{
+    job_system_t* jobs = &core->jobs;
+    Sint32        index;
+
+    if (jobs->wake_lock && jobs->wake)
+    {
+        SDL_LockMutex(jobs->wake_lock);
+        jobs->quit = SDL_TRUE;
+        SDL_CondBroadcast(jobs->wake);
+        SDL_UnlockMutex(jobs->wake_lock);
+    }
+
+    for (index = 0; index < jobs->worker_count; index += 1)
+    {
+        SDL_WaitThread(jobs->worker[index].thread, NULL);
+        jobs->worker[index].thread = NULL;
+    }
+    jobs->worker_count = 0;
+
+    if (jobs->wake)
+    {
+        SDL_DestroyCond(jobs->wake);
+        jobs->wake = NULL;
+    }
+
+    if (jobs->wake_lock)
+    {
+        SDL_DestroyMutex(jobs->wake_lock);
+        jobs->wake_lock = NULL;
+    }
+}
+
+Sint32 get_job_worker_count(ngine_t* core)
+{
+    return core->jobs.worker_count;
+}
+
+// Returns the index of the job or -1 if the batch is full.  The name
+// shows up in traces.
+Sint32 add_job(const char* name, job_function_t function, Sint32 first, Sint32 count, ngine_t* core)
+{
+    job_system_t* jobs = &core->jobs;
+    job_t*        job;
+
+    if (jobs->job_count >= NG_MAX_JOBS)
+    {
+        //SDL_Log("%s: too many jobs.", FUNCTION_NAME);
+        jobs->is_overflowed = SDL_TRUE;
+        return -1;
+    }
+
+    job                  = &jobs->job[jobs->job_count];
+    job->name            = name;
+    job->function        = function;
+    job->first           = first;
+    job->count           = count;
+    job->successor_count = 0;
+    job->status          = NG_OK;
+    SDL_AtomicSet(&job->pending, 0);
+
+    jobs->job_count += 1;
+
+    return jobs->job_count - 1;
+}
+
+// Prerequisites have to be added before the jobs depending on them,
+// which rules out cycles.
+status_t add_job_dependency(Sint32 job, Sint32 prerequisite, ngine_t* core)
+{
+    job_system_t* jobs = &core->jobs;
+    job_t*        entry;
+
+    if (0 > prerequisite || prerequisite >= job || job >= jobs->job_count)
+    {
+        return NG_WARNING;
+    }
+
+    entry = &jobs->job[prerequisite];
+    if (entry->successor_count >= NG_MAX_JOB_SUCCESSORS)
+    {
+        //SDL_Log("%s: too many successors.", FUNCTION_NAME);
+        jobs->is_overflowed = SDL_TRUE;
+        return NG_ERROR;
+    }
+
+    entry->successor[entry->successor_count]  = job;
+    entry->successor_count                   += 1;
+    SDL_AtomicAdd(&jobs->job[job].pending, 1);
+
+    return NG_OK;
+}
+
+// Runs all jobs added since the last call and returns once every one of
+// them has finished.  The result is the worst status of all jobs.
+status_t run_jobs(ngine_t* core)
+{
+    job_system_t* jobs   = &core->jobs;
+    status_t      status = NG_OK;
+    Sint32        next   = 0;
+    Sint32        index;
+
+    if (jobs->is_overflowed)
+    {
+        jobs->job_count     = 0;
+        jobs->is_overflowed = SDL_FALSE;
+        return NG_ERROR;
+    }
+
+    if (0 == jobs->job_count)
+    {
+        return NG_OK;
+    }
+
+    for (index = 0; index <= jobs->worker_count; index += 1)
+    {
+        SDL_AtomicLock(&jobs->deque[index].lock);
+        jobs->deque[index].head = 0;
+        jobs->deque[index].tail = 0;
+        SDL_AtomicUnlock(&jobs->deque[index].lock);
+    }
+
+    SDL_AtomicSet(&jobs->remaining, jobs->job_count);
+
+    // Deal the jobs that are ready out to all workers.
+    for (index = 0; index < jobs->job_count; index += 1)
+    {
+        if (0 == SDL_AtomicGet(&jobs->job[index].pending))
+        {
+            push_job(index, &jobs->deque[next % (jobs->worker_count + 1)]);
+            next += 1;
+        }
+    }
+
+    if (jobs->worker_count > 0)
+    {
+        SDL_LockMutex(jobs->wake_lock);
+        jobs->batch += 1;
+        SDL_CondBroadcast(jobs->wake);
+        SDL_UnlockMutex(jobs->wake_lock);
+    }
+
+    work_until_done(0, core);
+
+    for (index = 0; index < jobs->job_count; index += 1)
+    {
+        if (jobs->job[index].status > status)
+        {
+            status = jobs->job[index].status;
+        }
+    }
+
+    jobs->job_count = 0;
+
+    return status;
+}
@@ -29,6 +29,26 @@ int main(int argc, char *argv[])
         goto quit;
     }
 
+#if ! defined __SYMBIAN32__
+    // ngine --record <file> | --replay <file> | --trace <file>
+    if (argc > 2)
+    {
+        if (0 == SDL_strcmp(argv[1], "--record"))
+        {
+            ng_start_recording(argv[2], core);
+        }
+        else if (0 == SDL_strcmp(argv[1], "--replay"))
+        {
+            ng_start_replay(argv[2], core);
+        }
+        else if (0 == SDL_strcmp(argv[1], "--trace"))
+        {
+            ng_start_trace(argv[2], core);
+        }
+    }
+#endif
+
+    // Loaded after the options, so that a trace covers the load.
     status = ng_load_map("entry.tmj", core);
     if (NG_OK != status)
     {
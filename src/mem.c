@@ -0,0 +1,247 @@
+/** @file mem.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Tracking allocator.  Every allocation is tagged with the subsystem
+ *  it belongs to, which keeps track of its current and peak usage as
+ *  well as the number of live allocations.  Optional budgets per
+ *  subsystem turn allocations beyond them into failures.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include <stb_sprintf.h>
+#include "ngine.h"
+
+// Keeps the memory behind the header aligned for any type.
+typedef union mem_header
+{
+    struct
+    {
+        Uint32 size;
+        Uint32 tag;
+
+    } info;
+
+    Uint64 align[2];
+
+} mem_header_t;
+
+static const char* tag_name[MEM_TAG_COUNT] =
+{
+    "map",
+    "entity",
+    "path",
+    "render",
+    "tiled",
+    "scratch",
+    "texture",
+    "audio"
+};
+
+static void update_peak(Sint32 current, mem_usage_t* usage)
+{
+    Sint32 peak = SDL_AtomicGet(&usage->peak);
+
+    while (current > peak)
+    {
+        if (SDL_AtomicCAS(&usage->peak, peak, current))
+        {
+            break;
+        }
+        peak = SDL_AtomicGet(&usage->peak);
+    }
+}
+
+static void update_usage(Sint32 size, Sint32 count, mem_usage_t* usage)
+{
+    SDL_AtomicAdd(&usage->count, count);
+    update_peak(SDL_AtomicAdd(&usage->current, size) + size, usage);
+}
+
+// Reserves memory of a subsystem.  Fails without reserving anything if
+// its budget would be exceeded.
+static status_t reserve_memory(Sint32 size, mem_usage_t* usage)
+{
+    Sint32 current = SDL_AtomicAdd(&usage->current, size) + size;
+
+    if (usage->budget > 0 && current > usage->budget)
+    {
+        SDL_AtomicAdd(&usage->current, -size);
+        return NG_WARNING;
+    }
+
+    SDL_AtomicAdd(&usage->count, 1);
+    update_peak(current, usage);
+
+    return NG_OK;
+}
+
+void* alloc_memory(size_t size, mem_tag_t tag, ngine_t* core)
+{
+    mem_header_t* header;
+
+    if (size > 0x7fffffff || NG_OK != reserve_memory((Sint32)size, &core->mem[tag]))
+    {
+        //SDL_Log("%s: %s budget exceeded.", FUNCTION_NAME, tag_name[tag]);
+        return NULL;
+    }
+
+    header = (mem_header_t*)malloc(sizeof(union mem_header) + size);
+    if (! header)
+    {
+        update_usage(-(Sint32)size, -1, &core->mem[tag]);
+        return NULL;
+    }
+
+    SDL_AtomicAdd(&core->mem[tag].total, 1);
+
+    header->info.size = (Uint32)size;
+    header->info.tag  = (Uint32)tag;
+
+    return header + 1;
+}
+
+void* calloc_memory(size_t count, size_t size, mem_tag_t tag, ngine_t* core)
+{
+    void* memory;
+
+    if (0 != size && count > 0x7fffffff / size)
+    {
+        return NULL;
+    }
+
+    memory = alloc_memory(count * size, tag, core);
+    if (memory)
+    {
+        SDL_memset(memory, 0, count * size);
+    }
+
+    return memory;
+}
+
+void free_memory(void* memory, ngine_t* core)
+{
+    mem_header_t* header;
+
+    if (! memory)
+    {
+        return;
+    }
+
+    header = (mem_header_t*)memory - 1;
+    update_usage(-(Sint32)header->info.size, -1, &core->mem[header->info.tag]);
+    free(header);
+}
+
+// Textures are accounted for by their estimated size in memory.
+static Sint32 get_texture_size(SDL_Texture* texture)
+{
+    Uint32 format;
+    int    width;
+    int    height;
+
+    if (0 > SDL_QueryTexture(texture, &format, NULL, &width, &height))
+    {
+        return 0;
+    }
+
+    return width * height * (Sint32)SDL_BYTESPERPIXEL(format);
+}
+
+// Textures have already been created when they are tracked, so they
+// count against the budget but are never refused.
+void track_texture(SDL_Texture* texture, ngine_t* core)
+{
+    if (texture)
+    {
+        update_usage(get_texture_size(texture), 1, &core->mem[MEM_TEXTURE]);
+        SDL_AtomicAdd(&core->mem[MEM_TEXTURE].total, 1);
+    }
+}
+
+void destroy_texture(SDL_Texture** texture, ngine_t* core)
+{
+    if (*texture)
+    {
+        update_usage(-get_texture_size(*texture), -1, &core->mem[MEM_TEXTURE]);
+        SDL_DestroyTexture(*texture);
+        *texture = NULL;
+    }
+}
+
+// One line per subsystem: name, current and peak usage in KiB and the
+// number of live allocations, followed by the texture evictions and
+// failures so far.  Returns the length of the text.
+Sint32 format_memory_stats(char* text, Sint32 size, ngine_t* core)
+{
+    Sint32 length = 0;
+    Sint32 index;
+
+    text[0] = '\0';
+
+    for (index = 0; index < MEM_TAG_COUNT && length < size; index += 1)
+    {
+        mem_usage_t* usage = &core->mem[index];
+
+        length += stbsp_snprintf(
+            text + length,
+            size - length,
+            "%-7s%5dK%6dK%5d\n",
+            tag_name[index],
+            (SDL_AtomicGet(&usage->current) + 1023) / 1024,
+            (SDL_AtomicGet(&usage->peak) + 1023) / 1024,
+            SDL_AtomicGet(&usage->count));
+    }
+
+    if (length < size)
+    {
+        length += stbsp_snprintf(
+            text + length,
+            size - length,
+            "evicted%5d failed%4d\n",
+            core->textures.eviction_count,
+            core->textures.failure_count);
+    }
+
+    return SDL_min(length, size - 1);
+}
+
+void ng_get_memory_usage(mem_tag_t tag, Sint32* current, Sint32* peak, Sint32* count, ngine_t* core)
+{
+    if (tag >= MEM_TAG_COUNT)
+    {
+        return;
+    }
+
+    *current = SDL_AtomicGet(&core->mem[tag].current);
+    *peak    = SDL_AtomicGet(&core->mem[tag].peak);
+    *count   = SDL_AtomicGet(&core->mem[tag].count);
+}
+
+// Number of allocations made since start-up, over all subsystems.
+Sint32 get_allocation_count(ngine_t* core)
+{
+    Sint32 total = 0;
+    Sint32 tag;
+
+    for (tag = 0; tag < MEM_TAG_COUNT; tag += 1)
+    {
+        total += SDL_AtomicGet(&core->mem[tag].total);
+    }
+
+    return total;
+}
+
+// A budget of zero disables the limit.
+void ng_set_memory_budget(mem_tag_t tag, Sint32 budget, ngine_t* core)
+{
+    if (tag < MEM_TAG_COUNT)
+    {
+        core->mem[tag].budget = budget;
+    }
+}
@@ -0,0 +1,201 @@
+/** @file motion.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Fixed-point (16.16) sub-pixel motion with velocities, acceleration
+ *  and an optional side-view platformer mode with gravity.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include "ngine.h"
+
+// Scales a rate per second by a time in ms.  The division comes first
+// to keep the product within 32 bits.
+static fixed_t scale_by_time(fixed_t rate, Uint32 time_ms)
+{
+    return (rate / 1000) * (fixed_t)time_ms;
+}
+
+static Uint32 isqrt(Uint32 value)
+{
+    Uint32 result = 0;
+    Uint32 bit    = 1UL << 30;
+
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+
+    while (bit)
+    {
+        if (value >= result + bit)
+        {
+            value  -= result + bit;
+            result  = (result >> 1) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return result;
+}
+
+// Moves the velocity towards the target by at most step.
+static fixed_t approach(fixed_t velocity, fixed_t target, fixed_t step)
+{
+    if (velocity < target)
+    {
+        return SDL_min(velocity + step, target);
+    }
+
+    if (velocity > target)
+    {
+        return SDL_max(velocity - step, target);
+    }
+
+    return velocity;
+}
+
+// Gravity is given in 1/100000 m/s^2, as stored in the map properties.
+void init_physics(Sint32 gravity, Sint32 meter_in_pixel, Sint32 jump_height, ngine_t* core)
+{
+    physics_t* physics = &core->map->physics;
+    Uint32     gravity_px;
+
+    SDL_memset(physics, 0, sizeof(struct physics));
+
+    if (0 >= gravity || 0 >= meter_in_pixel)
+    {
+        return;
+    }
+
+    if (0 >= jump_height)
+    {
+        jump_height = NG_JUMP_HEIGHT;
+    }
+
+    // Pixels per second squared in 24.8, which leaves enough headroom
+    // for the jump velocity below.
+    gravity_px = (Uint32)((((Sint64)gravity * meter_in_pixel) << 8) / 100000);
+
+    physics->gravity       = (fixed_t)(gravity_px << 8);
+    physics->is_platformer = SDL_TRUE;
+
+    // v = sqrt(2 * g * h); the square root of a 24.8 value is 28.4.
+    physics->jump_velocity = (fixed_t)(isqrt(2 * gravity_px * (Uint32)jump_height) << 12);
+}
+
+void set_motion_input(entity_handle_t handle, Sint32 input_x, Sint32 input_y, SDL_bool wants_jump, ngine_t* core)
+{
+    Sint32           index = get_entity_index(handle, core);
+    entity_motion_t* motion;
+
+    if (0 > index)
+    {
+        return;
+    }
+
+    motion             = &core->map->entity.motion[index];
+    motion->input_x    = SDL_clamp(input_x, -1, 1);
+    motion->input_y    = SDL_clamp(input_y, -1, 1);
+    motion->wants_jump = wants_jump;
+}
+
+void update_motion(ngine_t* core)
+{
+    physics_t* physics = &core->map->physics;
+    Uint32     time_ms = SDL_min(core->time_since_last_frame, NG_MAX_STEP_TIME);
+    Uint32     serial  = core->map_serial;
+    Sint32     index;
+
+    for (index = 0; index < core->map->entity_count; index += 1)
+    {
+        entity_motion_t* motion = &core->map->entity.motion[index];
+        Sint32           pos_x;
+        Sint32           pos_y;
+        Sint32           offset_x;
+        Sint32           offset_y;
+        fixed_t          step;
+
+        if (! motion->is_enabled)
+        {
+            continue;
+        }
+
+        step          = scale_by_time(INT_TO_FX(motion->input_x ? NG_WALK_ACCEL : NG_WALK_FRICTION), time_ms);
+        motion->vel_x = approach(motion->vel_x, INT_TO_FX(motion->input_x * NG_WALK_SPEED), step);
+
+        if (physics->is_platformer)
+        {
+            motion->is_grounded = (0 == sweep_entity_y(index, 1, core)) ? SDL_TRUE : SDL_FALSE;
+
+            if (motion->is_grounded && motion->vel_y > 0)
+            {
+                motion->vel_y  = 0;
+                motion->frac_y = 0;
+            }
+
+            if (motion->is_grounded && motion->wants_jump)
+            {
+                motion->vel_y       = -physics->jump_velocity;
+                motion->is_grounded = SDL_FALSE;
+            }
+
+            motion->vel_y = SDL_min(motion->vel_y + scale_by_time(physics->gravity, time_ms), INT_TO_FX(NG_MAX_FALL_SPEED));
+        }
+        else
+        {
+            step          = scale_by_time(INT_TO_FX(motion->input_y ? NG_WALK_ACCEL : NG_WALK_FRICTION), time_ms);
+            motion->vel_y = approach(motion->vel_y, INT_TO_FX(motion->input_y * NG_WALK_SPEED), step);
+        }
+
+        motion->wants_jump = SDL_FALSE;
+
+        // Whole pixels go to the position, the remainder is carried over
+        // to the next frame.
+        motion->frac_x += scale_by_time(motion->vel_x, time_ms);
+        motion->frac_y += scale_by_time(motion->vel_y, time_ms);
+        offset_x        = FX_TO_INT(motion->frac_x);
+        offset_y        = FX_TO_INT(motion->frac_y);
+        motion->frac_x &= FX_FRAC_MASK;
+        motion->frac_y &= FX_FRAC_MASK;
+
+        if (! offset_x && ! offset_y)
+        {
+            continue;
+        }
+
+        pos_x = core->map->entity.pos_x[index];
+        pos_y = core->map->entity.pos_y[index];
+
+        move_entity(get_entity_handle(index, core), offset_x, offset_y, core);
+
+        // The map has been replaced: all indices are stale.
+        if (serial != core->map_serial || ! core->map)
+        {
+            return;
+        }
+
+        // Blocked by a wall: drop the velocity along that axis.
+        if (core->map->entity.pos_x[index] - pos_x != offset_x)
+        {
+            motion->vel_x  = 0;
+            motion->frac_x = 0;
+        }
+
+        if (core->map->entity.pos_y[index] - pos_y != offset_y)
+        {
+            motion->is_grounded = (offset_y > 0) ? SDL_TRUE : SDL_FALSE;
+            motion->vel_y       = 0;
+            motion->frac_y      = 0;
+        }
+    }
+}
@@ -24,6 +24,19 @@ status_t ng_init(const char* resource_file, const char* title, ngine_t** core)
         return NG_ERROR;
     }
 
+    (*core)->behaviour_budget_us = NG_SCHED_BUDGET_US;
+    init_profiler(*core);
+
+    if (NG_OK != init_arena(NG_FRAME_ARENA_SIZE, &(*core)->frame_arena, *core))
+    {
+        return NG_ERROR;
+    }
+
+    if (NG_OK != init_arena(NG_LOAD_ARENA_SIZE, &(*core)->load_arena, *core))
+    {
+        return NG_ERROR;
+    }
+
     SDL_SetMainReady();
 
     if (0 != SDL_Init(SDL_INIT_VIDEO))
@@ -44,39 +57,56 @@ status_t ng_init(const char* resource_file, const char* title, ngine_t** core)
         return NG_ERROR;
     }
 
-    (*core)->renderer = SDL_CreateRenderer((*core)->window, 0, SDL_RENDERER_SOFTWARE);
-    if (! (*core)->renderer)
-    {
-        //SDL_Log("Could not create renderer: %s", SDL_GetError());
-        SDL_DestroyWindow((*core)->window);
-        return NG_ERROR;
-    }
-    if (0 != SDL_RenderSetIntegerScale((*core)->renderer, SDL_TRUE))
-    {
-        //SDL_Log("Could not enable integer scale: %s", SDL_GetError());
-        status = NG_WARNING;
-    }
-
+    // The font is loaded along with the renderer.
     init_file_reader(resource_file);
 
-    if (NG_OK != load_font((*core)))
+    status = init_renderer(*core);
+    if (NG_ERROR == status)
     {
         return NG_ERROR;
     }
 
+    // Without worker threads, jobs run serially.  Like a missing audio
+    // device, this is not reported.
+    init_jobs(*core);
+
+    // Without an audio device, the engine runs silently: this is not
+    // reported, as the launcher quits on anything but NG_OK.
+    init_audio(*core);
+
     return status;
 }
 
 status_t ng_update(ngine_t* core)
 {
-    status_t     status     = NG_OK;
-    Uint32       delta_time = 0;
-    const Uint8* keystate   = SDL_GetKeyboardState(NULL);
-    SDL_Event    event;
-    Sint32       player_index;
+    status_t      status     = NG_OK;
+    Uint32        delta_time = 0;
+    input_event_t event;
+    Sint32        player_index;
+    Uint32*       state;
+    Uint64        start;
+
+    // Nothing allocated during the last frame survives it.
+    reset_arena(&core->frame_arena);
+    next_stats_frame(core);
+    next_profile_frame(core);
+    start = begin_profile();
 
     core->time_b = core->time_a;
-    core->time_a = SDL_GetTicks();
+
+    // Recording and replaying run on a fixed clock.
+    if (is_replay_active(core))
+    {
+        core->time_a = core->time_b + core->replay.tick_ms;
+    }
+    else if (core->fixed_step_ms > 0)
+    {
+        core->time_a = core->time_b + core->fixed_step_ms;
+    }
+    else
+    {
+        core->time_a = SDL_GetTicks();
+    }
 
     // Calculate delta time.
     if (core->time_a > core->time_b)
@@ -89,90 +119,115 @@ status_t ng_update(ngine_t* core)
     }
     core->time_since_last_frame = delta_time;
 
-    // Set-up basic controls/events.
-    if (is_map_loaded(core))
+    // Drain all pending events before anything else, so that input is
+    // never more than one frame old.
+    update_input(core);
+
+    status = update_replay(core);
+    if (NG_OK != status)
+    {
+        goto exit;
+    }
+
+    // Discrete actions are handled in the order they occurred.
+    while (get_input_event(&event, core))
     {
-        player_index = core->map->active_entity - 1;
-        CLR_STATE(core->map->entity[player_index].state, S_WALK);
+        if (! event.is_down)
+        {
+            continue;
+        }
 
-        if (keystate[SDL_SCANCODE_UP])
+        switch (event.key)
         {
-            SET_STATE(core->map->entity[player_index].state, S_WALK);
-            SET_STATE(core->map->entity[player_index].state, S_UP);
-            CLR_STATE(core->map->entity[player_index].state, S_DOWN);
-            CLR_STATE(core->map->entity[player_index].state, S_LEFT);
-            CLR_STATE(core->map->entity[player_index].state, S_RIGHT);
-            move_entity(&core->map->entity[player_index], 0, -2, core);
+            case NG_KEY_EXIT:
+                status = NG_EXIT;
+                goto exit;
+            case NG_KEY_ACTION:
+                trigger_action(core);
+                break;
+            case NG_KEY_DEBUG:
+                core->debug_mode = !core->debug_mode;
+                break;
+            default:
+                clear_display_text(core);
+                break;
         }
-        if (keystate[SDL_SCANCODE_DOWN])
+    }
+
+    // Set-up basic controls.  The player may have been despawned.
+    if (is_map_loaded(core) && 0 <= get_entity_index(core->map->active_entity, core))
+    {
+        SDL_bool is_platformer = core->map->physics.is_platformer;
+        Sint32   input_x       = 0;
+        Sint32   input_y       = 0;
+
+        player_index = get_entity_index(core->map->active_entity, core);
+        state        = &core->map->entity.state[player_index];
+        CLR_STATE(*state, S_WALK);
+
+        // In platformer mode, up jumps and down does nothing.
+        if (ng_is_key_down(NG_KEY_UP, core) && ! is_platformer)
         {
-            SET_STATE(core->map->entity[player_index].state, S_WALK);
-            SET_STATE(core->map->entity[player_index].state, S_DOWN);
-            CLR_STATE(core->map->entity[player_index].state, S_UP);
-            CLR_STATE(core->map->entity[player_index].state, S_LEFT);
-            CLR_STATE(core->map->entity[player_index].state, S_RIGHT);
-            move_entity(&core->map->entity[player_index], 0, 2, core);
+            SET_STATE(*state, S_WALK);
+            SET_STATE(*state, S_UP);
+            CLR_STATE(*state, S_DOWN);
+            CLR_STATE(*state, S_LEFT);
+            CLR_STATE(*state, S_RIGHT);
+            input_y -= 1;
         }
-        if (keystate[SDL_SCANCODE_LEFT])
+        if (ng_is_key_down(NG_KEY_DOWN, core) && ! is_platformer)
         {
-            SET_STATE(core->map->entity[player_index].state, S_WALK);
-            SET_STATE(core->map->entity[player_index].state, S_LEFT);
-            CLR_STATE(core->map->entity[player_index].state, S_RIGHT);
-            CLR_STATE(core->map->entity[player_index].state, S_UP);
-            CLR_STATE(core->map->entity[player_index].state, S_DOWN);
-            move_entity(&core->map->entity[player_index], -2, 0, core);
+            SET_STATE(*state, S_WALK);
+            SET_STATE(*state, S_DOWN);
+            CLR_STATE(*state, S_UP);
+            CLR_STATE(*state, S_LEFT);
+            CLR_STATE(*state, S_RIGHT);
+            input_y += 1;
         }
-        if (keystate[SDL_SCANCODE_RIGHT])
+        if (ng_is_key_down(NG_KEY_LEFT, core))
         {
-            SET_STATE(core->map->entity[player_index].state, S_WALK);
-            SET_STATE(core->map->entity[player_index].state, S_RIGHT);
-            CLR_STATE(core->map->entity[player_index].state, S_LEFT);
-            CLR_STATE(core->map->entity[player_index].state, S_UP);
-            CLR_STATE(core->map->entity[player_index].state, S_DOWN);
-            move_entity(&core->map->entity[player_index], 2, 0, core);
+            SET_STATE(*state, S_WALK);
+            SET_STATE(*state, S_LEFT);
+            CLR_STATE(*state, S_RIGHT);
+            CLR_STATE(*state, S_UP);
+            CLR_STATE(*state, S_DOWN);
+            input_x -= 1;
         }
-    }
-
-    if (SDL_PollEvent(&event))
-    {
-        switch (event.type)
+        if (ng_is_key_down(NG_KEY_RIGHT, core))
         {
-            case SDL_KEYDOWN:
-            {
-                switch (event.key.keysym.sym)
-                {
-                    case SDLK_BACKSPACE:
-                        status = NG_EXIT;
-                        goto exit;
-                    case SDLK_5:
-                        trigger_action(core);
-                        break;
-                    case SDLK_9:
-                        core->debug_mode = !core->debug_mode;
-                        break;
-                    default:
-                        clear_display_text(core);
-                        break;
-                }
-            }
-            case SDL_KEYUP:
-            {
-                switch (event.key.keysym.sym)
-                {
-                    default:
-                        break;
-                }
-            }
+            SET_STATE(*state, S_WALK);
+            SET_STATE(*state, S_RIGHT);
+            CLR_STATE(*state, S_LEFT);
+            CLR_STATE(*state, S_UP);
+            CLR_STATE(*state, S_DOWN);
+            input_x += 1;
         }
+
+        set_motion_input(
+            core->map->active_entity,
+            input_x,
+            input_y,
+            (is_platformer && ng_is_key_pressed(NG_KEY_UP, core)) ? SDL_TRUE : SDL_FALSE,
+            core);
     }
 
-    update_camera(core);
-    status = render_scene(core);
-    if (NG_OK != status)
+    end_profile(PROF_INPUT, start, core);
+    start = begin_profile();
+
+    // Entering a new map resets the scheduler along with the map.
+    if (is_map_loaded(core))
     {
-        goto exit;
+        update_motion(core);
+        update_scheduler(core);
+        update_path_finder(core);
     }
-    status = draw_scene(core);
+
+    update_camera(core);
+    end_profile(PROF_SIMULATION, start, core);
+
+    update_audio(core);
+
+    status = present_frame(core);
 
 exit:
     return status;
@@ -180,45 +235,276 @@ exit:
 
 void ng_free(ngine_t *core)
 {
-    if (core->display_text)
+    ng_stop_replay(core);
+    ng_stop_trace(core);
+
+    // A render thread takes its renderer along.
+    free_render_thread(core);
+    free_jobs(core);
+    free_audio(core);
+
+    free_renderer(core);
+
+    if (core->window)
     {
-        free(core->display_text);
-        core->display_text = NULL;
+        SDL_DestroyWindow(core->window);
     }
 
-    if (core->font_texture)
+    free_arena(&core->frame_arena);
+    free_arena(&core->load_arena);
+
+    if (core)
     {
-        SDL_DestroyTexture(core->font_texture);
-        core->font_texture = NULL;
+        free(core);
     }
 
-    if (core->render_target)
+    SDL_Quit();
+}
+
+// The texture is re-created on demand.
+static status_t drop_render_target(ngine_t* core)
+{
+    if (! core->use_render_target && core->render_target)
     {
-        SDL_DestroyTexture(core->render_target);
-        core->render_target = NULL;
+        SDL_SetRenderTarget(core->renderer, NULL);
+        destroy_texture(&core->render_target, core);
     }
 
-    if (core->window)
+    return NG_OK;
+}
+
+void ng_use_render_target(SDL_bool enable, ngine_t* core)
+{
+    lock_renderer(core);
+
+    core->use_render_target = enable;
+    call_renderer(drop_render_target, core);
+
+    unlock_renderer(core);
+}
+
+void ng_set_behaviour_budget(Uint32 budget_us, ngine_t* core)
+{
+    core->behaviour_budget_us = budget_us;
+}
+
+// Runs the simulation on a fixed clock of step_ms per update instead of
+// the wall clock, e.g. for benchmarks.  Zero restores the wall clock.
+void ng_set_fixed_time_step(Uint32 step_ms, ngine_t* core)
+{
+    core->fixed_step_ms = step_ms;
+}
+
+static status_t run_load_tiles(Sint32 first, Sint32 count, ngine_t* core)
+{
+    (void)first;
+    (void)count;
+    return load_tiles(core);
+}
+
+static status_t run_load_entities(Sint32 first, Sint32 count, ngine_t* core)
+{
+    (void)first;
+    (void)count;
+    return load_entities(core);
+}
+
+static status_t run_load_tileset(Sint32 first, Sint32 count, ngine_t* core)
+{
+    (void)first;
+    (void)count;
+    return load_tileset(core);
+}
+
+static status_t run_load_animated_tiles(Sint32 first, Sint32 count, ngine_t* core)
+{
+    (void)first;
+    (void)count;
+    return load_animated_tiles(core);
+}
+
+static status_t run_init_grid(Sint32 first, Sint32 count, ngine_t* core)
+{
+    (void)first;
+    (void)count;
+    return init_grid(core);
+}
+
+static status_t run_init_draw_order(Sint32 first, Sint32 count, ngine_t* core)
+{
+    (void)first;
+    (void)count;
+    return init_draw_order(core);
+}
+
+static status_t run_load_triggers(Sint32 first, Sint32 count, ngine_t* core)
+{
+    (void)first;
+    (void)count;
+    return load_triggers(core);
+}
+
+// Stages [3] to [10] only depend on the parsed map and on the entities,
+// so they are run as jobs: images are decoded and tables are built
+// concurrently where worker threads are available.
+static status_t run_load_stages(ngine_t* core)
+{
+    Sint32 tiles;
+    Sint32 entities;
+    Sint32 grid;
+    Sint32 depth;
+    Sint32 triggers;
+    Sint32 slice;
+    Sint32 index;
+
+    // [3] Tiles.
+    tiles = add_job("tiles", run_load_tiles, 0, 0, core);
+
+    // [4] Entities.
+    entities = add_job("entities", run_load_entities, 0, 0, core);
+
+    // [5] Tileset.
+    add_job("tileset", run_load_tileset, 0, 0, core);
+
+    // [6] Sprites, one slice per thread.
+    slice = (core->map->sprite_count + get_job_worker_count(core)) / (get_job_worker_count(core) + 1);
+    for (index = 0; index < core->map->sprite_count; index += slice)
     {
-        SDL_DestroyWindow(core->window);
+        add_job("sprites", load_sprites, index, slice, core);
     }
 
-    if (core->renderer)
+    // [7] Animated tiles.
+    add_job("animated tiles", run_load_animated_tiles, 0, 0, core);
+
+    // [8] Spatial grid.
+    grid = add_job("grid", run_init_grid, 0, 0, core);
+    add_job_dependency(grid, entities, core);
+
+    // [9] Draw order.
+    depth = add_job("draw order", run_init_draw_order, 0, 0, core);
+    add_job_dependency(depth, entities, core);
+
+    // [10] Triggers.
+    triggers = add_job("triggers", run_load_triggers, 0, 0, core);
+    add_job_dependency(triggers, entities, core);
+    add_job_dependency(triggers, tiles, core);
+
+    return run_jobs(core);
+}
+
+// Runs on the thread that owns the renderer.
+static status_t free_map_textures(ngine_t* core)
+{
+    Sint32 index;
+
+    destroy_texture(&core->map->layer_texture, core);
+
+    destroy_texture(&core->map->animated_tile_texture, core);
+
+    // [6] Sprites.
+    if (core->map->sprite)
     {
-        SDL_DestroyRenderer(core->renderer);
+        for (index = 0; index < core->map->sprite_count; index += 1)
+        {
+            destroy_texture(&core->map->sprite[index].texture, core);
+        }
     }
 
-    if (core)
+    // [5] Tileset.
+    destroy_texture(&core->map->tileset_texture, core);
+
+    // Nothing left to evict.
+    clear_textures(core);
+
+    return NG_OK;
+}
+
+// Frees whatever part of the map has been loaded so far: every stage
+// tolerates being freed before it has been loaded.
+static void free_map(ngine_t* core)
+{
+    Sint32 index;
+
+    if (! core->map)
     {
-        free(core);
+        return;
     }
 
-    SDL_Quit();
+    call_renderer(free_map_textures, core);
+
+    // Free up allocated memory in reverse order.
+
+    // [12] Audio.
+    free_map_audio(core);
+
+    // [11] Render snapshots.
+    free_snapshots(core);
+
+    // Path finder (allocated on first request).
+    free_path_finder(core);
+
+    // [10] Triggers.
+    free_triggers(core);
+
+    // [9] Draw order.
+    free_draw_order(core);
+
+    // [8] Spatial grid.
+    free_grid(core);
+
+    // [7] Animated tiles.
+    free_memory(core->map->animated_tile, core);
+
+    // [6] Sprites.
+    if (core->map->sprite)
+    {
+        for (index = 0; index < core->map->sprite_count; index += 1)
+        {
+            core->map->sprite[index].id = 0;
+
+            if (core->map->sprite[index].surface)
+            {
+                SDL_FreeSurface(core->map->sprite[index].surface);
+                core->map->sprite[index].surface = NULL;
+            }
+        }
+    }
+
+    free_memory(core->map->sprite, core);
+    core->map->sprite = NULL;
+
+    // [5] Tileset.
+    if (core->map->tileset_surface)
+    {
+        SDL_FreeSurface(core->map->tileset_surface);
+        core->map->tileset_surface = NULL;
+    }
+
+    if (core->map->bake_tileset)
+    {
+        SDL_FreeSurface(core->map->bake_tileset);
+        core->map->bake_tileset = NULL;
+    }
+
+    // [4] Entities.
+    free_entities(core);
+
+    // [3] Tiles.
+    free_tile_attr(core);
+
+    // [2] Tiled map.
+    unload_tiled_map(core);
+
+    // [1] Map.
+    free_memory(core->map, core);
+    core->map = NULL;
 }
 
 status_t ng_load_map(const char* map_name, ngine_t* core)
 {
     status_t status = NG_OK;
+    Uint64   start  = begin_profile();
+    Uint64   stage;
 
     if (is_map_loaded(core))
     {
@@ -226,77 +512,94 @@ status_t ng_load_map(const char* map_name, ngine_t* core)
         return NG_WARNING;
     }
 
+    // Textures are created and destroyed while loading: keep the render
+    // thread out until the map is complete.
+    lock_renderer(core);
+    begin_stats_load(core);
+
     // Load map file and allocate required memory.
 
     // [1] Map.
-    core->map = (map_t*)calloc(1, sizeof(struct map));
+    core->map = (map_t*)calloc_memory(1, sizeof(struct map), MEM_MAP, core);
     if (! core->map)
     {
         //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+        end_stats_load(core);
+        unlock_renderer(core);
         return NG_WARNING;
     }
+    core->map_serial += 1;
 
     // [2] Tiled map.
+    stage  = begin_profile();
     status = load_tiled_map(map_name, core);
     if (NG_OK != status)
     {
-        free(core->map);
+        free_memory(core->map, core);
+        core->map = NULL;
         goto exit;
     }
+    trace_event("load", "tiled map", stage, core);
 
-    // [3] Tiles.
-    status = load_tiles(core);
-    if (NG_OK != status)
-    {
-        goto exit;
-    }
+    // The map file is no longer needed.
+    reset_arena(&core->load_arena);
 
-    // [4] Entities.
-    status = load_entities(core);
+    core->map->height = (Sint32)((Sint32)core->map->handle->height * get_tile_height(core->map->handle));
+    core->map->width  = (Sint32)((Sint32)core->map->handle->width  * get_tile_width(core->map->handle));
+
+    load_physics(core);
+
+    // The sprite sheets are looked up before they are decoded in [6].
+    status = alloc_sprites(core);
     if (NG_OK != status)
     {
         goto exit;
     }
 
-    // [5] Tileset.
-    status = load_tileset(core);
+    // [3] - [10].
+    status = run_load_stages(core);
     if (NG_OK != status)
     {
         goto exit;
     }
 
-    // [6] Sprites.
-    status = load_sprites(core);
+    // Textures of [5] and [6].
+    stage  = begin_profile();
+    status = call_renderer(load_map_textures, core);
     if (NG_OK != status)
     {
         goto exit;
     }
+    trace_event("load", "textures", stage, core);
 
-    // [7] Animated tiles.
-    status = load_animated_tiles(core);
+    // [11] Render snapshots.
+    status = alloc_snapshots(core);
     if (NG_OK != status)
     {
         goto exit;
     }
 
-    core->map->height = (Sint32)((Sint32)core->map->handle->height * get_tile_height(core->map->handle));
-    core->map->width  = (Sint32)((Sint32)core->map->handle->width  * get_tile_width(core->map->handle));
+    // [12] Audio.  A map without its sounds or music is still playable.
+    load_map_audio(core);
 
 exit:
     if (NG_OK != status)
     {
-        ng_unload_map(core);
+        free_map(core);
     }
 
+    reset_arena(&core->load_arena);
     clear_display_text(core);
-    core->is_map_loaded = SDL_TRUE;
+    core->is_map_loaded = (NG_OK == status) ? SDL_TRUE : SDL_FALSE;
+    trace_event("load", map_name, start, core);
+    end_stats_load(core);
+
+    unlock_renderer(core);
     return status;
 }
 
 void ng_unload_map(ngine_t* core)
 {
-    Sint32 index;
-
     if (! is_map_loaded(core))
     {
         //SDL_Log("No map has been loaded.");
@@ -304,59 +607,7 @@ void ng_unload_map(ngine_t* core)
     }
     core->is_map_loaded = SDL_FALSE;
 
-    if (core->map->layer_texture)
-    {
-        SDL_DestroyTexture(core->map->layer_texture);
-        core->map->layer_texture = NULL;
-    }
-
-    if (core->map->animated_tile_texture)
-    {
-        SDL_DestroyTexture(core->map->animated_tile_texture);
-        core->map->animated_tile_texture = NULL;
-    }
-
-    // Free up allocated memory in reverse order.
-
-    // [7] Animated tiles.
-    free(core->map->animated_tile);
-
-    // [6] Sprites.
-    if (core->map->sprite_count > 0)
-    {
-        for (index = 0; index < core->map->sprite_count; index += 1)
-        {
-            core->map->sprite[index].id = 0;
-
-            if (core->map->sprite[index].texture)
-            {
-                SDL_DestroyTexture(core->map->sprite[index].texture);
-                core->map->sprite[index].texture = NULL;
-            }
-        }
-    }
-
-    free(core->map->sprite);
-    core->map->sprite = NULL;
-
-    // [5] Tileset.
-    if (core->map->tileset_texture)
-    {
-        SDL_DestroyTexture(core->map->tileset_texture);
-        core->map->tileset_texture = NULL;
-    }
-
-    // [4] Entities.
-    free(core->map->entity);
-
-    // [3] Tiles.
-    free(core->map->tile_desc);
-    core->map->tile_desc = NULL;
-
-    // [2] Tiled map.
-    unload_tiled_map(core);
-
-    // [1] Map.
-    free(core->map);
-    core->map = NULL;
+    lock_renderer(core);
+    free_map(core);
+    unlock_renderer(core);
 }
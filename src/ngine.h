@@ -19,10 +19,228 @@
 #define FUNCTION_NAME ""
 #endif
 
-status_t ng_init_core(const char* resource_file, const char* title, ngine_t** core);
-status_t ng_update_core(ngine_t* core);
-void     ng_free_core(ngine_t *core);
-status_t ng_load_map(const char* map_name, ngine_t* core);
-void     ng_unload_map(ngine_t* core);
+status_t        ng_init(const char* resource_file, const char* title, ngine_t** core);
+status_t        ng_update(ngine_t* core);
+void            ng_free(ngine_t *core);
+void            ng_use_render_target(SDL_bool enable, ngine_t* core);
+status_t        ng_use_render_thread(SDL_bool enable, ngine_t* core);
+void            ng_set_behaviour_budget(Uint32 budget_us, ngine_t* core);
+void            ng_set_fixed_time_step(Uint32 step_ms, ngine_t* core);
+SDL_bool        ng_is_key_down(Uint32 key, ngine_t* core);
+SDL_bool        ng_is_key_pressed(Uint32 key, ngine_t* core);
+SDL_bool        ng_is_key_released(Uint32 key, ngine_t* core);
+status_t        ng_start_recording(const char* file_name, ngine_t* core);
+status_t        ng_start_replay(const char* file_name, ngine_t* core);
+void            ng_stop_replay(ngine_t* core);
+status_t        ng_start_trace(const char* file_name, ngine_t* core);
+void            ng_stop_trace(ngine_t* core);
+void            ng_get_memory_usage(mem_tag_t tag, Sint32* current, Sint32* peak, Sint32* count, ngine_t* core);
+void            ng_set_memory_budget(mem_tag_t tag, Sint32 budget, ngine_t* core);
+void            ng_get_stats(stat_t stat, Sint32* frame, Sint32* load, ngine_t* core);
+status_t        ng_load_map(const char* map_name, ngine_t* core);
+void            ng_unload_map(ngine_t* core);
+status_t        ng_play_music(const char* file_name, ngine_t* core);
+void            ng_stop_music(ngine_t* core);
+Sint32          ng_play_sound(Sint32 id, Sint32 volume, ngine_t* core);
+entity_handle_t ng_spawn_entity(entity_handle_t prototype, Sint32 pos_x, Sint32 pos_y, ngine_t* core);
+void            ng_despawn_entity(entity_handle_t handle, ngine_t* core);
+
+// arena.c
+status_t init_arena(Uint32 size, arena_t* arena, ngine_t* core);
+void     free_arena(arena_t* arena);
+void*    alloc_arena(Uint32 size, arena_t* arena);
+void     reset_arena(arena_t* arena);
+void*    alloc_scratch(Uint32 size, arena_t* arena);
+void     free_scratch(void* memory, arena_t* arena);
+
+// audio.c
+status_t init_audio(ngine_t* core);
+void     free_audio(ngine_t* core);
+void     update_audio(ngine_t* core);
+status_t load_map_audio(ngine_t* core);
+void     free_map_audio(ngine_t* core);
+
+// collision.c
+aabb_t   get_entity_aabb(Sint32 index, ngine_t* core);
+Sint32   sweep_entity_x(Sint32 index, Sint32 offset_x, ngine_t* core);
+Sint32   sweep_entity_y(Sint32 index, Sint32 offset_y, ngine_t* core);
+SDL_bool do_entities_overlap(Sint32 index_a, Sint32 index_b, ngine_t* core);
+Sint32   get_overlapping_entities(Sint32 index, Sint32* result, Sint32 max_results, ngine_t* core);
+
+// core.c
+SDL_bool    is_map_loaded(ngine_t* core);
+status_t    load_tiled_map(const char* map_file_name, ngine_t* core);
+void        unload_tiled_map(ngine_t* core);
+status_t    load_tiles(ngine_t* core);
+status_t    load_tileset(ngine_t* core);
+status_t    load_animated_tiles(ngine_t* core);
+status_t    load_entities(ngine_t* core);
+status_t    load_triggers(ngine_t* core);
+void        load_physics(ngine_t* core);
+status_t    load_font(ngine_t* core);
+Uint64      generate_hash(const unsigned char* name);
+SDL_bool    is_tile_animated(Sint32 gid, Sint32* animation_length, Sint32* id, cute_tiled_map_t* tiled_map);
+void        trigger_action(ngine_t* core);
+void        update_camera(ngine_t* core);
+void        move_entity(entity_handle_t handle, Sint32 offset_x, Sint32 offset_y, ngine_t* core);
+Sint32      get_tile_index(Sint32 pos_x, Sint32 pos_y, ngine_t* core);
+SDL_bool    get_boolean_map_property(const Uint64 name_hash, ngine_t* core);
+float       get_decimal_map_property(const Uint64 name_hash, ngine_t* core);
+Sint32      get_integer_map_property(const Uint64 name_hash, ngine_t* core);
+const char* get_string_map_property(const Uint64 name_hash, ngine_t* core);
+SDL_bool    get_boolean_property(const Uint64 name_hash, cute_tiled_property_t* properties, Sint32 property_count, ngine_t* core);
+float       get_decimal_property(const Uint64 name_hash, cute_tiled_property_t* properties, Sint32 property_count, ngine_t* core);
+Sint32      get_integer_property(const Uint64 name_hash, cute_tiled_property_t* properties, Sint32 property_count, ngine_t* core);
+const char* get_string_property(const Uint64 name_hash, cute_tiled_property_t* properties, Sint32 property_count, ngine_t* core);
+void        build_snapshot(snapshot_t* snapshot, ngine_t* core);
+status_t    render_snapshot(const snapshot_t* snapshot, ngine_t* core);
+status_t    draw_scene(SDL_bool is_map_loaded, ngine_t* core);
+status_t    alloc_sprites(ngine_t* core);
+status_t    load_sprites(Sint32 first, Sint32 count, ngine_t* core);
+status_t    load_map_textures(ngine_t* core);
+status_t    bake_layers(ngine_t* core);
+int         get_tile_width(cute_tiled_map_t* tiled_map);
+int         get_tile_height(cute_tiled_map_t* tiled_map);
+
+// depth.c
+status_t init_draw_order(ngine_t* core);
+void     free_draw_order(ngine_t* core);
+void     add_draw_order(Sint32 index, ngine_t* core);
+void     remove_draw_order(Sint32 index, ngine_t* core);
+void     mark_draw_order_dirty(ngine_t* core);
+void     update_draw_order(ngine_t* core);
+void     sort_by_draw_order(Sint32* list, Sint32 count, ngine_t* core);
+
+// entity.c
+status_t        alloc_entities(Sint32 count, ngine_t* core);
+void            free_entities(ngine_t* core);
+entity_handle_t get_entity_handle(Sint32 index, ngine_t* core);
+Sint32          get_entity_index(entity_handle_t handle, ngine_t* core);
+Sint32          add_entity(ngine_t* core);
+void            set_entity_position(entity_handle_t handle, Sint32 pos_x, Sint32 pos_y, ngine_t* core);
+
+// grid.c
+status_t init_grid(ngine_t* core);
+void     free_grid(ngine_t* core);
+void     update_grid_entity(Sint32 index, ngine_t* core);
+void     insert_grid_entity(Sint32 index, ngine_t* core);
+void     remove_grid_entity(Sint32 index, ngine_t* core);
+Sint32   query_grid_rect(Sint32 pos_x, Sint32 pos_y, Sint32 width, Sint32 height, Sint32* result, Sint32 max_results, ngine_t* core);
+Sint32   query_grid_radius(Sint32 pos_x, Sint32 pos_y, Sint32 radius, Sint32* result, Sint32 max_results, ngine_t* core);
+
+// input.c
+void     update_input(ngine_t* core);
+SDL_bool get_input_event(input_event_t* event, ngine_t* core);
+
+// job.c
+status_t init_jobs(ngine_t* core);
+void     free_jobs(ngine_t* core);
+Sint32   get_job_worker_count(ngine_t* core);
+Sint32   add_job(const char* name, job_function_t function, Sint32 first, Sint32 count, ngine_t* core);
+status_t add_job_dependency(Sint32 job, Sint32 prerequisite, ngine_t* core);
+status_t run_jobs(ngine_t* core);
+
+// mem.c
+void*    alloc_memory(size_t size, mem_tag_t tag, ngine_t* core);
+void*    calloc_memory(size_t count, size_t size, mem_tag_t tag, ngine_t* core);
+void     free_memory(void* memory, ngine_t* core);
+void     track_texture(SDL_Texture* texture, ngine_t* core);
+void     destroy_texture(SDL_Texture** texture, ngine_t* core);
+Sint32   format_memory_stats(char* text, Sint32 size, ngine_t* core);
+Sint32   get_allocation_count(ngine_t* core);
+
+// motion.c
+void     init_physics(Sint32 gravity, Sint32 meter_in_pixel, Sint32 jump_height, ngine_t* core);
+void     set_motion_input(entity_handle_t handle, Sint32 input_x, Sint32 input_y, SDL_bool wants_jump, ngine_t* core);
+void     update_motion(ngine_t* core);
+
+// path.c
+void          free_path_finder(ngine_t* core);
+void          update_path_finder(ngine_t* core);
+path_status_t find_path(Sint32 start_cell, Sint32 goal_cell, const path_t** path, ngine_t* core);
+path_status_t get_flow_direction(Sint32 goal_cell, Sint32 cell, Sint32* dir_x, Sint32* dir_y, ngine_t* core);
+
+// pfs.c
+void     init_file_reader(const char* dataFilePath);
+size_t   size_of_file(const char* path);
+Uint8*   load_binary_file_from_path(const char* path);
+FILE*    open_binary_file_from_path(const char* path);
+size_t   read_binary_file_from_path(const char* path, Uint8* buffer, size_t bufferSize);
+size_t   read_binary_chunk(FILE* file, Uint8* buffer, size_t bufferSize);
+void     close_binary_file(FILE* file);
+int      list_files(void (*visit)(const char* path, void* data), void* data);
+void     take_file_reader_stats(int* fileOpens, int* bytesRead);
+
+// prof.c
+void     init_profiler(ngine_t* core);
+void     next_profile_frame(ngine_t* core);
+Uint64   begin_profile(void);
+void     end_profile(prof_section_t section, Uint64 start, ngine_t* core);
+Sint32   format_profile_stats(char* text, Sint32 size, ngine_t* core);
+
+// render.c
+status_t init_renderer(ngine_t* core);
+status_t free_renderer(ngine_t* core);
+void     free_render_thread(ngine_t* core);
+status_t call_renderer(render_call_t function, ngine_t* core);
+void     lock_renderer(ngine_t* core);
+void     unlock_renderer(ngine_t* core);
+status_t alloc_snapshots(ngine_t* core);
+void     free_snapshots(ngine_t* core);
+status_t present_frame(ngine_t* core);
+
+// replay.c
+SDL_bool is_replay_active(ngine_t* core);
+status_t update_replay(ngine_t* core);
+
+// sched.c
+void     update_scheduler(ngine_t* core);
+
+// tileattr.c
+status_t alloc_tile_attr(Sint32 cols, Sint32 rows, ngine_t* core);
+void     free_tile_attr(ngine_t* core);
+void     set_tile_attr(tile_attr_t attr, Sint32 col, Sint32 row, SDL_bool enable, ngine_t* core);
+SDL_bool is_tile_attr_set(tile_attr_t attr, Sint32 col, Sint32 row, ngine_t* core);
+SDL_bool is_row_attr_set(tile_attr_t attr, Sint32 row, Sint32 first_col, Sint32 last_col, ngine_t* core);
+SDL_bool is_rect_attr_set(tile_attr_t attr, Sint32 first_col, Sint32 first_row, Sint32 last_col, Sint32 last_row, ngine_t* core);
+
+// stats.c
+void     next_stats_frame(ngine_t* core);
+void     begin_stats_load(ngine_t* core);
+void     end_stats_load(ngine_t* core);
+void     count_draw(const SDL_Texture* texture, const SDL_Rect* dst, ngine_t* core);
+void     count_stat(stat_t stat, Sint32 amount, ngine_t* core);
+Sint32   format_stats(char* text, Sint32 size, ngine_t* core);
+
+// texture.c
+SDL_Texture* create_texture(Uint32 format, int access, int width, int height, ngine_t* core);
+SDL_Texture* create_texture_from_surface(SDL_Surface* surface, ngine_t* core);
+Sint32       register_texture(SDL_Texture** texture, texture_loader_t reload, Sint32 index, ngine_t* core);
+void         clear_textures(ngine_t* core);
+void         next_texture_frame(ngine_t* core);
+status_t     use_texture(Sint32 slot, ngine_t* core);
+
+// trace.c
+void     trace_event(const char* category, const char* name, Uint64 start, ngine_t* core);
+
+// trigger.c
+status_t         alloc_triggers(Sint32 trigger_count, Sint32 slot_count, ngine_t* core);
+void             free_triggers(ngine_t* core);
+void             add_trigger(Sint32 entity, trigger_type_t type, const char* text, Sint32 width, Sint32 height, ngine_t* core);
+void             update_trigger_entity(Sint32 entity, ngine_t* core);
+void             remove_trigger_entity(Sint32 entity, ngine_t* core);
+const trigger_t* find_trigger(Sint32 col, Sint32 row, ngine_t* core);
+
+// utils.c
+SDL_bool bb_do_intersect(const aabb_t bb_a, const aabb_t bb_b);
+Sint32   floor_div(Sint32 value, Sint32 divisor);
+Uint8*   load_resource(const char* file_name, Uint32* size, ngine_t* core);
+status_t load_surface_from_file(const char* file_name, SDL_Surface** surface, ngine_t* core);
+status_t load_texture_from_surface(SDL_Surface** surface, SDL_Texture** texture, ngine_t* core);
+status_t load_texture_from_file(const char* file_name, SDL_Texture** texture, ngine_t* core);
+status_t set_display_text(const char* text, ngine_t* core);
+void     clear_display_text(ngine_t* core);
+void     render_text(const char* text, ngine_t* core);
+void     render_debug_text(const char* text, Sint32 pos_x, Sint32 pos_y, ngine_t* core);
 
 #endif /* NGINE_H */
@@ -14,12 +14,120 @@
 #define NGTYPES_H
 
 #include <SDL.h>
+#include <stdio.h>
 #include <cute_tiled.h>
 
 #define CLR_STATE(var, pos) var &= ~(1UL << pos)
 #define SET_STATE(var, pos) var |=   1UL << pos
 #define IS_STATE_SET(var, pos) ((0U == (var & (1 << pos))) ? 0U : 1U)
 
+// 16.16 fixed-point arithmetic; the N-Gage has no FPU.
+#define FX_SHIFT       16
+#define FX_ONE         (1 << FX_SHIFT)
+#define FX_FRAC_MASK   (FX_ONE - 1)
+#define INT_TO_FX(x)   ((fixed_t)(x) << FX_SHIFT)
+#define FX_TO_INT(x)   ((x) >> FX_SHIFT)
+
+// Edge length of a spatial grid cell in tiles.
+#define NG_GRID_CELL_TILES 4
+
+// Entities above the map edge still need a positive depth key.
+#define NG_DEPTH_BIAS            256
+#define NG_DEPTH_RADIX_THRESHOLD 64
+
+// Motion: speeds in pixels per second, accelerations in pixels per
+// second squared.
+#define NG_WALK_SPEED      60
+#define NG_WALK_ACCEL      600
+#define NG_WALK_FRICTION   900
+#define NG_MAX_FALL_SPEED  256
+#define NG_JUMP_HEIGHT     40
+#define NG_MAX_STEP_TIME   100
+
+// Pathfinding: nodes expanded per frame and cache dimensions.
+#define NG_PATH_NODE_BUDGET  256
+#define NG_PATH_CACHE_SIZE   16
+#define NG_PATH_MAX_LENGTH   64
+#define NG_PATH_QUEUE_SIZE   16
+#define NG_FLOW_FIELD_COUNT  4
+
+// Behaviour scheduler: default time budget per frame in microseconds,
+// default update rate in Hz and the rate divisor for entities far away
+// from the camera.
+#define NG_SCHED_BUDGET_US    2000
+#define NG_SCHED_DEFAULT_RATE 20
+#define NG_SCHED_FAR_DIVISOR  4
+#define NG_SCHED_NEAR_MARGIN  32
+
+// Capacity of the input event ring buffer.
+#define NG_INPUT_QUEUE_SIZE 32
+
+// Key bit masks.
+#define NG_KEY_UP     (1U << 0)
+#define NG_KEY_DOWN   (1U << 1)
+#define NG_KEY_LEFT   (1U << 2)
+#define NG_KEY_RIGHT  (1U << 3)
+#define NG_KEY_ACTION (1U << 4)
+#define NG_KEY_DEBUG  (1U << 5)
+#define NG_KEY_EXIT   (1U << 6)
+#define NG_KEY_OTHER  (1U << 7)
+
+// Display text is limited to what fits into the text box.
+#define NG_DISPLAY_TEXT_SIZE 145
+
+// Number of simulation snapshots in flight between simulation and
+// rendering.
+#define NG_SNAPSHOT_COUNT 3
+
+// Length of a tick while recording or replaying input.
+#define NG_REPLAY_TICK_MS 33
+
+// Scratch arenas: transient data of a frame and of a map load.
+#define NG_FRAME_ARENA_SIZE 0x1000
+#define NG_LOAD_ARENA_SIZE  0x20000
+
+// Size of the text shown by the debug overlay.
+#define NG_DEBUG_TEXT_SIZE 512
+
+// Frames kept by the profiler for its statistics.
+#define NG_PROF_FRAMES 128
+
+// Trace capture: events kept until the trace is written and the length
+// of their names.
+#define NG_TRACE_EVENTS    0x10000
+#define NG_TRACE_NAME_SIZE 24
+
+// Tile rows per band when baking map layers.
+#define NG_BAKE_BAND_ROWS 4
+
+// Entity pool: spare slots for entities spawned at runtime unless the
+// map sets entity_capacity, and the bits of a handle used for the index.
+#define NG_ENTITY_POOL_SPARE  32
+#define NG_ENTITY_INDEX_BITS  16
+#define NG_ENTITY_INDEX_MASK  ((1U << NG_ENTITY_INDEX_BITS) - 1)
+
+// Job system: jobs per batch, worker threads and successors per job.
+#define NG_MAX_JOBS           64
+#define NG_MAX_JOB_WORKERS    8
+#define NG_MAX_JOB_SUCCESSORS 8
+
+// Textures that can be evicted and re-created on demand.
+#define NG_MAX_TEXTURES 64
+
+// Audio: output rate, samples per callback (the latency of sound
+// effects), length of the music ring buffer in samples (a power of two),
+// bytes read from the PFS at a time, voices for sound effects, full
+// volume and the length of a file name.
+#define NG_AUDIO_RATE      16000
+#define NG_AUDIO_SAMPLES   512
+#define NG_AUDIO_RING      4096
+#define NG_AUDIO_BLOCK     1024
+#define NG_AUDIO_VOICES    4
+#define NG_AUDIO_VOLUME    128
+#define NG_AUDIO_NAME_SIZE 64
+
+typedef Sint32 fixed_t;
+
 typedef enum status
 {
     NG_OK = 0,
@@ -49,10 +157,10 @@ typedef enum
 
 typedef struct aabb
 {
-    Uint8 bottom;
-    Uint8 left;
-    Uint8 right;
-    Uint8 top;
+    Sint32 bottom;
+    Sint32 left;
+    Sint32 right;
+    Sint32 top;
 
 } aabb_t;
 
@@ -77,29 +185,108 @@ typedef struct animation
 
 } animation_t;
 
-typedef struct entity
+// Handle of an entity: its index + 1 in the lower bits and the
+// generation of its slot in the upper bits, so that handles of despawned
+// entities are recognised as stale once the slot is reused.  Zero is
+// never a valid handle.
+typedef Uint32 entity_handle_t;
+
+typedef struct entity_render
+{
+    Sint32 width;
+    Sint32 height;
+    Sint32 sprite_id;
+    Sint32 sprite_cols;
+
+} entity_render_t;
+
+typedef struct entity_body
+{
+    Sint32 width;
+    Sint32 height;
+
+} entity_body_t;
+
+// Sub-pixel motion state.  The fraction holds the part of the position
+// below one pixel; the integer part lives in pos_x/pos_y.
+typedef struct entity_motion
 {
-    cute_tiled_object_t* handle;
-    state_t              state;
-    Sint32               pos_x;
-    Sint32               pos_y;
-    Sint32               uid;
-    Sint32               id;
-    Sint32               index;
-    Sint32               width;
-    Sint32               height;
-    Sint32               sprite_id;
-    animation_t          animation;
+    fixed_t  vel_x;
+    fixed_t  vel_y;
+    fixed_t  frac_x;
+    fixed_t  frac_y;
+    Sint32   input_x;
+    Sint32   input_y;
+    SDL_bool wants_jump;
+    SDL_bool is_grounded;
+    SDL_bool is_enabled;
+
+} entity_motion_t;
+
+typedef enum behaviour
+{
+    B_NONE = 0,
+    B_WANDER,
+    B_FOLLOW_PLAYER
+
+} behaviour_t;
 
-} entity_t;
+typedef struct entity_brain
+{
+    behaviour_t behaviour;
+    Uint32      interval;
+    Uint32      next_update;
+    Uint32      last_update;
+    Uint32      seed;
+    Sint32      dir_x;
+    Sint32      dir_y;
+    Sint32      steps_left;
+
+} entity_brain_t;
+
+// Entities are stored as a structure of arrays, so that the per-frame
+// loops only touch the columns they need.
+typedef struct entity_store
+{
+    Sint32*               pos_x;
+    Sint32*               pos_y;
+    Uint32*               state;
+    animation_t*          animation;
+    entity_render_t*      render;
+    entity_body_t*        body;
+    entity_brain_t*       brain;
+    entity_motion_t*      motion;
+    cute_tiled_object_t** handle;
+    Sint32*               uid;
+    Uint16*               generation;
+    Sint32*               next_free;
+    SDL_bool*             is_alive;
+    Sint32                capacity;
+    Sint32                free_head;
+    Sint32                live_count;
+
+} entity_store_t;
 
 typedef struct sprite
 {
     SDL_Texture* texture;
+    SDL_Surface* surface;
+    const char*  file_name;
     Sint32       id;
+    Sint32       texture_slot;
 
 } sprite_t;
 
+// Samples are signed 16-bit mono at the rate of the file; step is the
+// number of samples per output sample in 16.16 fixed point.
+typedef struct sound
+{
+    Sint16* sample;
+    Sint32  length;
+    Uint32  step;
+
+} sound_t;
+
 typedef struct animated_tile
 {
     Sint32 dst_x;
@@ -111,11 +298,178 @@ typedef struct animated_tile
 
 } animated_tile_t;
 
-typedef struct tile_desc
+typedef enum tile_attr
+{
+    TA_SOLID = 0,
+    TA_WATER,
+    TA_DAMAGING,
+    TA_TRIGGER,
+    TA_ONE_WAY,
+    TA_COUNT
+
+} tile_attr_t;
+
+typedef struct tile_attr_grid
+{
+    Uint32* plane[TA_COUNT];
+    Sint32  words_per_row;
+    Sint32  cols;
+    Sint32  rows;
+
+} tile_attr_grid_t;
+
+typedef struct spatial_grid
+{
+    Sint32* cell_head;
+    Sint32* cell;
+    Sint32* next;
+    Sint32* prev;
+    Sint32* result;
+    Sint32  cell_size;
+    Sint32  cols;
+    Sint32  rows;
+    Sint32  capacity;
+    Sint32  max_extent_x;
+    Sint32  max_extent_y;
+
+} spatial_grid_t;
+
+typedef struct depth_order
+{
+    Sint32* order;
+    Sint32* scratch;
+    Sint32* rank;
+    Sint32  count;
+    Sint32  capacity;
+    Sint32  moved_count;
+
+} depth_order_t;
+
+typedef enum path_status
+{
+    PATH_NONE = 0,
+    PATH_PENDING,
+    PATH_FOUND,
+    PATH_FAILED
+
+} path_status_t;
+
+typedef enum
+{
+    FLOW_NONE = 0,
+    FLOW_RIGHT,
+    FLOW_LEFT,
+    FLOW_DOWN,
+    FLOW_UP
+
+} flow_direction_t;
+
+// Path from start to goal cell (inclusive); cells are row * cols + col.
+typedef struct path
 {
-    SDL_bool is_solid;
+    Sint32        cell[NG_PATH_MAX_LENGTH];
+    Sint32        length;
+    Sint32        start;
+    Sint32        goal;
+    Uint32        version;
+    Uint32        last_used;
+    path_status_t status;
 
-} tile_desc_t;
+} path_t;
+
+typedef struct flow_field
+{
+    Uint8*        direction;
+    Sint32        goal;
+    Uint32        version;
+    Uint32        last_used;
+    path_status_t status;
+
+} flow_field_t;
+
+typedef struct path_finder
+{
+    path_t        cache[NG_PATH_CACHE_SIZE];
+    flow_field_t  flow[NG_FLOW_FIELD_COUNT];
+    Sint32        queue[NG_PATH_QUEUE_SIZE];
+    Sint32        queue_head;
+    Sint32        queue_count;
+
+    Sint32*       g;
+    Sint32*       f;
+    Sint32*       parent;
+    Sint32*       heap;
+    Sint32*       heap_pos;
+    Uint32*       seen;
+    Sint32        heap_size;
+    Sint32        queue_read;
+    Sint32        cell_count;
+    Uint32        search_id;
+    Uint32        tick;
+    SDL_bool      is_searching;
+
+} path_finder_t;
+
+typedef enum trigger_type
+{
+    TRIGGER_NONE = 0,
+    TRIGGER_DISPLAY_TEXT
+
+} trigger_type_t;
+
+// A trigger covers the tiles of its owner's region; point objects cover
+// the single tile they are placed on.
+typedef struct trigger
+{
+    const char*    text;
+    trigger_type_t type;
+    Sint32         entity;
+    Sint32         width;
+    Sint32         height;
+    Sint32         first_col;
+    Sint32         first_row;
+    Sint32         last_col;
+    Sint32         last_row;
+
+} trigger_t;
+
+typedef struct trigger_slot
+{
+    Sint32 tile;
+    Sint32 trigger;
+
+} trigger_slot_t;
+
+// Open addressing hash table from tile index to trigger.  A tile may be
+// stored more than once if triggers overlap.
+typedef struct trigger_table
+{
+    trigger_t*      trigger;
+    trigger_slot_t* slot;
+    Sint32*         entity_trigger;
+    Sint32          count;
+    Sint32          capacity;
+    Sint32          entity_count;
+    Uint32          mask;
+    Sint32          bits;
+
+} trigger_table_t;
+
+// Map-wide physics settings, read once at load.
+typedef struct physics
+{
+    fixed_t  gravity;
+    fixed_t  jump_velocity;
+    SDL_bool is_platformer;
+
+} physics_t;
+
+typedef struct scheduler
+{
+    Uint32 time;
+    Sint32 cursor;
+
+} scheduler_t;
 
 typedef struct map
 {
@@ -129,40 +483,412 @@ typedef struct map
     animated_tile_t*   animated_tile;
     Sint32             animated_tile_index;
     Uint32             time_since_last_anim_frame;
+    Uint32             animated_tile_version;
 
     SDL_Texture*       animated_tile_texture;
     SDL_Texture*       layer_texture;
     SDL_Texture*       tileset_texture;
-
-    SDL_bool           boolean_property;
-    float              decimal_property;
-    Sint32             integer_property;
-    const char*        string_property;
-
-    entity_t*          entity;
+    SDL_Surface*       tileset_surface;
+    SDL_Surface*       bake_tileset;
+    SDL_Surface*       bake_surface;
+    Sint32             bake_first_row;
+    Sint32             layer_slot;
+    Sint32             tileset_slot;
+
+    entity_store_t     entity;
     Sint32             entity_count;
-    Sint32             active_entity;
+    entity_handle_t    active_entity;
     sprite_t*          sprite;
     Sint32             sprite_count;
-    tile_desc_t*       tile_desc;
-    Sint32             tile_desc_count;
+    sound_t*           sound;
+    Sint32             sound_count;
+    tile_attr_grid_t   tile_attr;
+    Sint32             tile_count;
+    Uint32             version;
+    spatial_grid_t     grid;
+    depth_order_t      depth;
+    path_finder_t      path_finder;
+    scheduler_t        scheduler;
+    trigger_table_t    triggers;
+    physics_t          physics;
 
 } map_t;
 
-typedef struct ngine
+typedef struct input_event
+{
+    Uint32   timestamp;
+    Uint32   key;
+    SDL_bool is_down;
+
+} input_event_t;
+
+typedef struct input
+{
+    input_event_t queue[NG_INPUT_QUEUE_SIZE];
+    Sint32        head;
+    Sint32        count;
+    Uint32        keys_down;
+    Uint32        keys_pressed;
+    Uint32        keys_released;
+
+} input_t;
+
+typedef enum replay_mode
+{
+    REPLAY_OFF = 0,
+    REPLAY_RECORD,
+    REPLAY_PLAY
+
+} replay_mode_t;
+
+typedef struct replay
+{
+    SDL_RWops*    file;
+    replay_mode_t mode;
+    Uint32        tick;
+    Uint32        tick_ms;
+    Uint32        run_length;
+    Uint8         run_down;
+    Uint8         run_pressed;
+
+} replay_t;
+
+// Everything needed to draw an entity, resolved by the simulation.
+typedef struct draw_entity
 {
-    SDL_Renderer*  renderer;
-    SDL_Texture*   render_target;
-    SDL_Texture*   font_texture;
-    unsigned char* display_text;
-    SDL_Window*    window;
-    map_t*         map;
-    struct camera  camera;
+    Sint32   sprite_id;
+    SDL_Rect src;
+    SDL_Rect dst;
+    SDL_Rect debug_frame;
+    SDL_bool is_debug_solid;
+
+} draw_entity_t;
+
+typedef struct draw_tile
+{
+    SDL_Rect src;
+    SDL_Rect dst;
+
+} draw_tile_t;
+
+// Immutable view of the simulation state of one frame.
+typedef struct snapshot
+{
+    draw_entity_t* entity;
+    Sint32         entity_count;
+    Sint32         entity_capacity;
+    draw_tile_t*   tile;
+    Sint32         tile_count;
+    Sint32         tile_capacity;
+    Uint32         tile_version;
+    Sint32         camera_x;
+    Sint32         camera_y;
+    Uint32         map_serial;
     SDL_bool       is_map_loaded;
     SDL_bool       debug_mode;
-    Uint32         time_since_last_frame;
-    Uint32         time_a;
-    Uint32         time_b;
+    SDL_bool       has_text;
+    char           display_text[NG_DISPLAY_TEXT_SIZE];
+    char           debug_text[NG_DEBUG_TEXT_SIZE];
+
+} snapshot_t;
+
+struct ngine;
+
+// Work that has to be done on the thread that owns the renderer.
+typedef status_t (*render_call_t)(struct ngine* core);
+
+// Triple buffer: the simulation writes, the renderer reads and the
+// latest complete snapshot waits in between.
+typedef struct render
+{
+    snapshot_t    snapshot[NG_SNAPSHOT_COUNT];
+    Sint32        write;
+    Sint32        ready;
+    Sint32        read;
+    SDL_bool      is_fresh;
+    SDL_mutex*    buffer_lock;
+    SDL_cond*     is_ready;
+    SDL_cond*     is_done;
+    SDL_Thread*   thread;
+    SDL_bool      is_threaded;
+    SDL_bool      is_rendering;
+    Sint32        pause_count;
+    render_call_t call;
+    status_t      call_status;
+    SDL_bool      quit;
+    status_t      status;
+    Uint32        tile_version;
+
+} render_t;
+
+// Subsystems memory is accounted to.
+typedef enum mem_tag
+{
+    MEM_MAP = 0,
+    MEM_ENTITY,
+    MEM_PATH,
+    MEM_RENDER,
+    MEM_TILED,
+    MEM_SCRATCH,
+    MEM_TEXTURE,
+    MEM_AUDIO,
+    MEM_TAG_COUNT
+
+} mem_tag_t;
+
+typedef struct mem_usage
+{
+    SDL_atomic_t current;
+    SDL_atomic_t peak;
+    SDL_atomic_t count;
+    SDL_atomic_t total;
+    Sint32       budget;
+
+} mem_usage_t;
+
+typedef struct arena
+{
+    Uint8*        buffer;
+    Uint32        size;
+    SDL_atomic_t  used;
+    Uint32        high_water;
+    struct ngine* core;
+
+} arena_t;
+
+// Sections of a frame measured by the profiler.
+typedef enum prof_section
+{
+    PROF_INPUT = 0,
+    PROF_SIMULATION,
+    PROF_SNAPSHOT,
+    PROF_SCENE,
+    PROF_TEXT,
+    PROF_PRESENT,
+    PROF_SECTION_COUNT
+
+} prof_section_t;
+
+// Times are in microseconds.
+typedef struct prof_frame
+{
+    Uint32 section_us[PROF_SECTION_COUNT];
+    Uint32 frame_us;
+    Sint32 draw_count;
+
+} prof_frame_t;
+
+typedef struct profiler
+{
+    prof_frame_t frame[NG_PROF_FRAMES];
+    SDL_atomic_t section_us[PROF_SECTION_COUNT];
+    Uint64       frame_start;
+    Uint64       frequency;
+    Sint32       head;
+    Sint32       count;
+
+} profiler_t;
+
+// Counters of the render paths and of the packed file system.  Pixels
+// are those covered by draws, clipped to the current render target.
+typedef enum stat
+{
+    STAT_DRAWS = 0,
+    STAT_TEXTURE_SWITCHES,
+    STAT_PIXELS,
+    STAT_FILE_OPENS,
+    STAT_FILE_BYTES,
+    STAT_COUNT
+
+} stat_t;
+
+typedef struct stats
+{
+    SDL_atomic_t       counter[STAT_COUNT];
+    Sint32             frame[STAT_COUNT];
+    Sint32             load[STAT_COUNT];
+    Sint32             load_start[STAT_COUNT];
+    const SDL_Texture* last_texture;
+
+} stats_t;
+
+// A complete event in the Chrome trace-event format.  Times are in
+// performance counter ticks.
+typedef struct trace_event
+{
+    char        name[NG_TRACE_NAME_SIZE];
+    const char* category;
+    Uint64      start;
+    Uint64      end;
+    Uint32      thread;
+
+} trace_event_t;
+
+typedef struct trace
+{
+    trace_event_t* event;
+    SDL_atomic_t   count;
+    SDL_RWops*     file;
+    Uint64         base;
+    SDL_bool       is_active;
+
+} trace_t;
+
+// Re-creates the texture of a slot; index is passed on as registered.
+typedef status_t (*texture_loader_t)(Sint32 index, struct ngine* core);
+
+typedef struct texture_slot
+{
+    SDL_Texture**    texture;
+    texture_loader_t reload;
+    Sint32           index;
+    Uint32           last_used;
+
+} texture_slot_t;
+
+typedef struct texture_cache
+{
+    texture_slot_t slot[NG_MAX_TEXTURES];
+    Sint32         slot_count;
+    Uint32         frame;
+    Sint32         eviction_count;
+    Sint32         failure_count;
+
+} texture_cache_t;
+
+// A job processes the items [first, first + count) of whatever it
+// works on.
+typedef status_t (*job_function_t)(Sint32 first, Sint32 count, struct ngine* core);
+
+typedef struct job
+{
+    const char*    name;
+    job_function_t function;
+    Sint32         first;
+    Sint32         count;
+    SDL_atomic_t   pending;
+    Sint32         successor[NG_MAX_JOB_SUCCESSORS];
+    Sint32         successor_count;
+    status_t       status;
+
+} job_t;
+
+// Owner pushes and pops at the tail, thieves take from the head.
+typedef struct job_deque
+{
+    Sint32       job[NG_MAX_JOBS];
+    Sint32       head;
+    Sint32       tail;
+    SDL_SpinLock lock;
+
+} job_deque_t;
+
+typedef struct job_worker
+{
+    struct ngine* core;
+    Sint32        index;
+    SDL_Thread*   thread;
+    Uint32        batch;
+
+} job_worker_t;
+
+typedef struct job_system
+{
+    job_t        job[NG_MAX_JOBS];
+    Sint32       job_count;
+    job_deque_t  deque[NG_MAX_JOB_WORKERS + 1];
+    job_worker_t worker[NG_MAX_JOB_WORKERS];
+    Sint32       worker_count;
+    SDL_atomic_t remaining;
+    SDL_mutex*   wake_lock;
+    SDL_cond*    wake;
+    Uint32       batch;
+    SDL_bool     quit;
+    SDL_bool     is_overflowed;
+
+} job_system_t;
+
+typedef struct wav_format
+{
+    Uint32 rate;
+    Uint16 channels;
+    Uint16 bits;
+    Uint16 frame_size;
+
+} wav_format_t;
+
+typedef struct voice
+{
+    const sound_t* sound;
+    Sint32         index;
+    Uint32         frac;
+    Sint32         volume;
+
+} voice_t;
+
+// Music is streamed from the PFS into the ring buffer by the simulation
+// and consumed by the audio callback; only the positions are shared.
+typedef struct music
+{
+    FILE*        file;
+    char         file_name[NG_AUDIO_NAME_SIZE];
+    wav_format_t format;
+    Uint32       data_left;
+    Uint8        block[NG_AUDIO_BLOCK];
+    Sint32       block_pos;
+    Sint32       block_len;
+    Sint16       ring[NG_AUDIO_RING];
+    SDL_atomic_t read_pos;
+    SDL_atomic_t write_pos;
+    Uint32       step;
+    Uint32       frac;
+    Sint32       volume;
+    SDL_bool     is_playing;
+
+} music_t;
+
+typedef struct audio
+{
+    SDL_AudioDeviceID device;
+    Sint32            rate;
+    voice_t           voice[NG_AUDIO_VOICES];
+    Sint32            next_voice;
+    Sint32            sound_volume;
+    music_t           music;
+    Sint32            underrun_count;
+
+} audio_t;
+
+typedef struct ngine
+{
+    SDL_Renderer*   renderer;
+    SDL_Texture*    render_target;
+    SDL_Texture*    font_texture;
+    char            display_text[NG_DISPLAY_TEXT_SIZE];
+    SDL_Window*     window;
+    map_t*          map;
+    struct camera   camera;
+    input_t         input;
+    replay_t        replay;
+    render_t        render;
+    job_system_t    jobs;
+    arena_t         frame_arena;
+    arena_t         load_arena;
+    mem_usage_t     mem[MEM_TAG_COUNT];
+    texture_cache_t textures;
+    profiler_t      prof;
+    stats_t         stats;
+    audio_t         audio;
+    trace_t         trace;
+    Uint32          map_serial;
+    SDL_bool        is_map_loaded;
+    SDL_bool        use_render_target;
+    SDL_bool        debug_mode;
+    Uint32          behaviour_budget_us;
+    Uint32          fixed_step_ms;
+    Uint32          time_since_last_frame;
+    Uint32          time_a;
+    Uint32          time_b;
 
 } ngine_t;
 
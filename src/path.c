@@ -0,0 +1,551 @@
+/** @file path.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Budgeted grid pathfinding (A*) and flow fields over the solid tile
+ *  attribute plane.  Results are cached and keyed by start cell, goal
+ *  cell and map version.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include "ngine.h"
+
+static const Sint32 neighbour_x[4] = { 1, -1, 0,  0 };
+static const Sint32 neighbour_y[4] = { 0,  0, 1, -1 };
+
+static SDL_bool is_cell_passable(Sint32 col, Sint32 row, ngine_t* core)
+{
+    if (col < 0 || row < 0 || col >= core->map->tile_attr.cols || row >= core->map->tile_attr.rows)
+    {
+        return SDL_FALSE;
+    }
+
+    return is_tile_attr_set(TA_SOLID, col, row, core) ? SDL_FALSE : SDL_TRUE;
+}
+
+static Sint32 get_heuristic(Sint32 cell, Sint32 goal, Sint32 cols)
+{
+    Sint32 dist_x = (cell % cols) - (goal % cols);
+    Sint32 dist_y = (cell / cols) - (goal / cols);
+
+    if (dist_x < 0)
+    {
+        dist_x = -dist_x;
+    }
+    if (dist_y < 0)
+    {
+        dist_y = -dist_y;
+    }
+
+    return dist_x + dist_y;
+}
+
+static void swap_heap_nodes(Sint32 a, Sint32 b, path_finder_t* finder)
+{
+    Sint32 cell_a = finder->heap[a];
+
+    finder->heap[a]                   = finder->heap[b];
+    finder->heap[b]                   = cell_a;
+    finder->heap_pos[finder->heap[a]] = a;
+    finder->heap_pos[finder->heap[b]] = b;
+}
+
+static void sift_up(Sint32 pos, path_finder_t* finder)
+{
+    while (pos > 0)
+    {
+        Sint32 parent = (pos - 1) / 2;
+
+        if (finder->f[finder->heap[parent]] <= finder->f[finder->heap[pos]])
+        {
+            break;
+        }
+
+        swap_heap_nodes(pos, parent, finder);
+        pos = parent;
+    }
+}
+
+static void sift_down(Sint32 pos, path_finder_t* finder)
+{
+    for (;;)
+    {
+        Sint32 left     = (pos * 2) + 1;
+        Sint32 right    = left + 1;
+        Sint32 smallest = pos;
+
+        if (left < finder->heap_size && finder->f[finder->heap[left]] < finder->f[finder->heap[smallest]])
+        {
+            smallest = left;
+        }
+        if (right < finder->heap_size && finder->f[finder->heap[right]] < finder->f[finder->heap[smallest]])
+        {
+            smallest = right;
+        }
+
+        if (smallest == pos)
+        {
+            break;
+        }
+
+        swap_heap_nodes(pos, smallest, finder);
+        pos = smallest;
+    }
+}
+
+static void push_heap(Sint32 cell, path_finder_t* finder)
+{
+    finder->heap[finder->heap_size]  = cell;
+    finder->heap_pos[cell]           = finder->heap_size;
+    finder->heap_size               += 1;
+
+    sift_up(finder->heap_size - 1, finder);
+}
+
+static Sint32 pop_heap(path_finder_t* finder)
+{
+    Sint32 cell = finder->heap[0];
+
+    finder->heap_size -= 1;
+    if (finder->heap_size > 0)
+    {
+        finder->heap[0]                   = finder->heap[finder->heap_size];
+        finder->heap_pos[finder->heap[0]] = 0;
+        sift_down(0, finder);
+    }
+
+    // A heap position of -1 marks the cell as closed.
+    finder->heap_pos[cell] = -1;
+
+    return cell;
+}
+
+static status_t alloc_path_finder(ngine_t* core)
+{
+    path_finder_t* finder = &core->map->path_finder;
+    Sint32         count  = core->map->tile_attr.cols * core->map->tile_attr.rows;
+
+    if (finder->g)
+    {
+        return NG_OK;
+    }
+
+    if (0 >= count)
+    {
+        return NG_ERROR;
+    }
+
+    // g, f, parent, heap and heap position share one block; the search
+    // stamp lives in its own array.
+    finder->g = (Sint32*)calloc_memory((size_t)count * 5, sizeof(Sint32), MEM_PATH, core);
+    if (! finder->g)
+    {
+        //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+        return NG_ERROR;
+    }
+    finder->f        = finder->g      + count;
+    finder->parent   = finder->f      + count;
+    finder->heap     = finder->parent + count;
+    finder->heap_pos = finder->heap   + count;
+
+    finder->seen = (Uint32*)calloc_memory((size_t)count, sizeof(Uint32), MEM_PATH, core);
+    if (! finder->seen)
+    {
+        //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+        free_memory(finder->g, core);
+        finder->g = NULL;
+        return NG_ERROR;
+    }
+
+    finder->cell_count = count;
+
+    return NG_OK;
+}
+
+void free_path_finder(ngine_t* core)
+{
+    path_finder_t* finder = &core->map->path_finder;
+    Sint32         index;
+
+    for (index = 0; index < NG_FLOW_FIELD_COUNT; index += 1)
+    {
+        free_memory(finder->flow[index].direction, core);
+    }
+
+    free_memory(finder->g, core);
+    free_memory(finder->seen, core);
+    SDL_memset(finder, 0, sizeof(struct path_finder));
+}
+
+static SDL_bool enqueue_path_job(Sint32 job, path_finder_t* finder)
+{
+    if (finder->queue_count >= NG_PATH_QUEUE_SIZE)
+    {
+        return SDL_FALSE;
+    }
+
+    finder->queue[(finder->queue_head + finder->queue_count) % NG_PATH_QUEUE_SIZE]  = job;
+    finder->queue_count                                                           += 1;
+
+    return SDL_TRUE;
+}
+
+static void begin_search(Sint32 start, path_finder_t* finder)
+{
+    finder->search_id += 1;
+    finder->heap_size  = 0;
+
+    finder->seen[start]   = finder->search_id;
+    finder->g[start]      = 0;
+    finder->f[start]      = 0;
+    finder->parent[start] = -1;
+
+    push_heap(start, finder);
+    finder->is_searching = SDL_TRUE;
+}
+
+static void store_path(path_t* path, ngine_t* core)
+{
+    path_finder_t* finder = &core->map->path_finder;
+    Sint32         length = 0;
+    Sint32         cell;
+
+    for (cell = path->goal; cell >= 0; cell = finder->parent[cell])
+    {
+        length += 1;
+    }
+
+    // Long paths are truncated; the agent simply requests a new path
+    // once it reaches the end of the stored part.
+    path->length = SDL_min(length, NG_PATH_MAX_LENGTH);
+
+    for (cell = path->goal; cell >= 0; cell = finder->parent[cell])
+    {
+        length -= 1;
+        if (length < NG_PATH_MAX_LENGTH)
+        {
+            path->cell[length] = cell;
+        }
+    }
+
+    path->status = PATH_FOUND;
+}
+
+// Runs A* for at most *budget node expansions.  Returns SDL_TRUE once
+// the job has finished.
+static SDL_bool step_path_job(path_t* path, Sint32* budget, ngine_t* core)
+{
+    path_finder_t* finder = &core->map->path_finder;
+    Sint32         cols   = core->map->tile_attr.cols;
+
+    if (! finder->is_searching)
+    {
+        begin_search(path->start, finder);
+    }
+
+    while (*budget > 0 && finder->heap_size > 0)
+    {
+        Sint32 cell = pop_heap(finder);
+        Sint32 dir;
+
+        *budget -= 1;
+
+        if (cell == path->goal)
+        {
+            store_path(path, core);
+            finder->is_searching = SDL_FALSE;
+            return SDL_TRUE;
+        }
+
+        for (dir = 0; dir < 4; dir += 1)
+        {
+            Sint32 col  = (cell % cols) + neighbour_x[dir];
+            Sint32 row  = (cell / cols) + neighbour_y[dir];
+            Sint32 next = (row * cols) + col;
+            Sint32 cost = finder->g[cell] + 1;
+
+            if (! is_cell_passable(col, row, core))
+            {
+                continue;
+            }
+
+            if (finder->seen[next] != finder->search_id)
+            {
+                finder->seen[next]   = finder->search_id;
+                finder->g[next]      = cost;
+                finder->f[next]      = cost + get_heuristic(next, path->goal, cols);
+                finder->parent[next] = cell;
+                push_heap(next, finder);
+            }
+            else if (finder->heap_pos[next] >= 0 && cost < finder->g[next])
+            {
+                finder->g[next]      = cost;
+                finder->f[next]      = cost + get_heuristic(next, path->goal, cols);
+                finder->parent[next] = cell;
+                sift_up(finder->heap_pos[next], finder);
+            }
+        }
+    }
+
+    if (0 == finder->heap_size)
+    {
+        path->status         = PATH_FAILED;
+        finder->is_searching = SDL_FALSE;
+        return SDL_TRUE;
+    }
+
+    return SDL_FALSE;
+}
+
+// Breadth-first search outwards from the goal.  Every reached cell
+// stores the direction towards its parent, i.e. one step closer to the
+// goal.  The heap array doubles as FIFO queue.
+static SDL_bool step_flow_job(flow_field_t* flow, Sint32* budget, ngine_t* core)
+{
+    path_finder_t* finder = &core->map->path_finder;
+    Sint32         cols   = core->map->tile_attr.cols;
+
+    if (! finder->is_searching)
+    {
+        finder->search_id        += 1;
+        finder->queue_read        = 0;
+        finder->heap_size         = 1;
+        finder->heap[0]           = flow->goal;
+        finder->seen[flow->goal]  = finder->search_id;
+
+        SDL_memset(flow->direction, FLOW_NONE, (size_t)finder->cell_count);
+        finder->is_searching = SDL_TRUE;
+    }
+
+    while (*budget > 0 && finder->queue_read < finder->heap_size)
+    {
+        Sint32 cell = finder->heap[finder->queue_read];
+        Sint32 dir;
+
+        finder->queue_read += 1;
+        *budget            -= 1;
+
+        for (dir = 0; dir < 4; dir += 1)
+        {
+            Sint32 col  = (cell % cols) + neighbour_x[dir];
+            Sint32 row  = (cell / cols) + neighbour_y[dir];
+            Sint32 next = (row * cols) + col;
+
+            if (! is_cell_passable(col, row, core) || finder->seen[next] == finder->search_id)
+            {
+                continue;
+            }
+
+            finder->seen[next]              = finder->search_id;
+            finder->heap[finder->heap_size]  = next;
+            finder->heap_size               += 1;
+
+            // Pointing back: the opposite of the direction we came from.
+            flow->direction[next] = (Uint8)(FLOW_RIGHT + (dir ^ 1));
+        }
+    }
+
+    if (finder->queue_read >= finder->heap_size)
+    {
+        flow->status         = PATH_FOUND;
+        finder->is_searching = SDL_FALSE;
+        return SDL_TRUE;
+    }
+
+    return SDL_FALSE;
+}
+
+void update_path_finder(ngine_t* core)
+{
+    path_finder_t* finder = &core->map->path_finder;
+    Sint32         budget = NG_PATH_NODE_BUDGET;
+
+    if (! finder->g)
+    {
+        return;
+    }
+
+    while (budget > 0 && finder->queue_count > 0)
+    {
+        Sint32   job = finder->queue[finder->queue_head];
+        SDL_bool is_done;
+
+        if (job >= 0)
+        {
+            is_done = step_path_job(&finder->cache[job], &budget, core);
+        }
+        else
+        {
+            is_done = step_flow_job(&finder->flow[-job - 1], &budget, core);
+        }
+
+        if (is_done)
+        {
+            finder->queue_head   = (finder->queue_head + 1) % NG_PATH_QUEUE_SIZE;
+            finder->queue_count -= 1;
+        }
+    }
+}
+
+path_status_t find_path(Sint32 start_cell, Sint32 goal_cell, const path_t** path, ngine_t* core)
+{
+    path_finder_t* finder = &core->map->path_finder;
+    path_t*        slot   = NULL;
+    Sint32         index;
+
+    if (NG_OK != alloc_path_finder(core))
+    {
+        return PATH_FAILED;
+    }
+
+    if (start_cell < 0 || goal_cell < 0 || start_cell >= finder->cell_count || goal_cell >= finder->cell_count)
+    {
+        return PATH_FAILED;
+    }
+
+    finder->tick += 1;
+
+    for (index = 0; index < NG_PATH_CACHE_SIZE; index += 1)
+    {
+        path_t* entry = &finder->cache[index];
+
+        if (PATH_NONE != entry->status && entry->start == start_cell && entry->goal == goal_cell && entry->version == core->map->version)
+        {
+            entry->last_used = finder->tick;
+            if (path)
+            {
+                *path = entry;
+            }
+            return entry->status;
+        }
+    }
+
+    // Re-use the least recently used entry that is not being worked on.
+    for (index = 0; index < NG_PATH_CACHE_SIZE; index += 1)
+    {
+        path_t* entry = &finder->cache[index];
+
+        if (PATH_PENDING == entry->status)
+        {
+            continue;
+        }
+
+        if (! slot || entry->last_used < slot->last_used)
+        {
+            slot = entry;
+        }
+    }
+
+    if (! slot || ! enqueue_path_job((Sint32)(slot - finder->cache), finder))
+    {
+        // Too many requests in flight: try again next frame.
+        return PATH_PENDING;
+    }
+
+    slot->start     = start_cell;
+    slot->goal      = goal_cell;
+    slot->version   = core->map->version;
+    slot->length    = 0;
+    slot->last_used = finder->tick;
+    slot->status    = PATH_PENDING;
+
+    if (path)
+    {
+        *path = slot;
+    }
+
+    return PATH_PENDING;
+}
+
+path_status_t get_flow_direction(Sint32 goal_cell, Sint32 cell, Sint32* dir_x, Sint32* dir_y, ngine_t* core)
+{
+    path_finder_t* finder = &core->map->path_finder;
+    flow_field_t*  slot   = NULL;
+    Sint32         index;
+
+    *dir_x = 0;
+    *dir_y = 0;
+
+    if (NG_OK != alloc_path_finder(core))
+    {
+        return PATH_FAILED;
+    }
+
+    if (goal_cell < 0 || cell < 0 || goal_cell >= finder->cell_count || cell >= finder->cell_count)
+    {
+        return PATH_FAILED;
+    }
+
+    finder->tick += 1;
+
+    for (index = 0; index < NG_FLOW_FIELD_COUNT; index += 1)
+    {
+        flow_field_t* entry = &finder->flow[index];
+
+        if (PATH_NONE != entry->status && entry->goal == goal_cell && entry->version == core->map->version)
+        {
+            entry->last_used = finder->tick;
+
+            if (PATH_FOUND == entry->status)
+            {
+                Uint8 direction = entry->direction[cell];
+
+                if (FLOW_NONE == direction)
+                {
+                    return (cell == goal_cell) ? PATH_FOUND : PATH_FAILED;
+                }
+
+                *dir_x = neighbour_x[direction - FLOW_RIGHT];
+                *dir_y = neighbour_y[direction - FLOW_RIGHT];
+            }
+            return entry->status;
+        }
+    }
+
+    for (index = 0; index < NG_FLOW_FIELD_COUNT; index += 1)
+    {
+        flow_field_t* entry = &finder->flow[index];
+
+        if (PATH_PENDING == entry->status)
+        {
+            continue;
+        }
+
+        if (! slot || entry->last_used < slot->last_used)
+        {
+            slot = entry;
+        }
+    }
+
+    if (! slot)
+    {
+        return PATH_PENDING;
+    }
+
+    if (! slot->direction)
+    {
+        slot->direction = (Uint8*)calloc_memory((size_t)finder->cell_count, sizeof(Uint8), MEM_PATH, core);
+        if (! slot->direction)
+        {
+            //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+            return PATH_FAILED;
+        }
+    }
+
+    if (! enqueue_path_job(-(Sint32)(slot - finder->flow) - 1, finder))
+    {
+        return PATH_PENDING;
+    }
+
+    slot->goal      = goal_cell;
+    slot->version   = core->map->version;
+    slot->last_used = finder->tick;
+    slot->status    = PATH_PENDING;
+
+    return PATH_PENDING;
+}
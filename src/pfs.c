@@ -19,6 +19,33 @@
 
 char mDataPath[kDataPath_MaxLength];
 
+SDL_atomic_t mFileOpens;
+SDL_atomic_t mBytesRead;
+
+static FILE *open_pack(void)
+{
+    SDL_AtomicAdd(&mFileOpens, 1);
+
+    return fopen(mDataPath, "rb");
+}
+
+static size_t read_pack(void * ptr, size_t size, size_t count, FILE *pack)
+{
+    size_t read = fread(ptr, size, count, pack);
+
+    SDL_AtomicAdd(&mBytesRead, (int)(read * size));
+
+    return read;
+}
+
+/* Returns the number of times the pack has been opened and the bytes
+ * read from it since the last call. */
+void take_file_reader_stats(int * fileOpens, int * bytesRead)
+{
+    *fileOpens = SDL_AtomicSet(&mFileOpens, 0);
+    *bytesRead = SDL_AtomicSet(&mBytesRead, 0);
+}
+
 void init_file_reader(const char * dataFilePath)
 {
     sprintf (mDataPath, "%s", dataFilePath);
@@ -26,22 +53,22 @@ void init_file_reader(const char * dataFilePath)
 
 size_t size_of_file(const char * path)
 {
-    FILE   *mDataPack = fopen(mDataPath, "rb");
+    FILE   *mDataPack = open_pack();
     char    buffer[85];
     int     c;
     Uint32  size      = 0;
     Uint32  offset    = 0;
     Uint16  entries   = 0;
 
-    fread(&entries, 2, 1, mDataPack);
+    read_pack(&entries, 2, 1, mDataPack);
 
     for (c = 0; c < entries; ++c)
     {
         uint8_t stringSize = 0;
 
-        fread(&offset, 4, 1, mDataPack);
-        fread(&stringSize, 1, 1, mDataPack);
-        fread(&buffer, stringSize + 1, 1, mDataPack);
+        read_pack(&offset, 4, 1, mDataPack);
+        read_pack(&stringSize, 1, 1, mDataPack);
+        read_pack(&buffer, stringSize + 1, 1, mDataPack);
 
         if (!strcmp(buffer, path))
         {
@@ -57,7 +84,7 @@ found:
     }
 
     fseek(mDataPack, offset, SEEK_SET);
-    fread(&size, 4, 1, mDataPack);
+    read_pack(&size, 4, 1, mDataPack);
     fclose(mDataPack);
 
     return size;
@@ -65,7 +92,7 @@ found:
 
 Uint8 *load_binary_file_from_path(const char * path)
 {
-    FILE   *mDataPack = fopen(mDataPath, "rb");
+    FILE   *mDataPack = open_pack();
     Uint32  offset    = 0;
     Uint16  entries   = 0;
     char    buffer[85];
@@ -73,15 +100,15 @@ Uint8 *load_binary_file_from_path(const char * path)
     Uint32  size      = 0;
     Uint8  *toReturn;
 
-    fread(&entries, 2, 1, mDataPack);
+    read_pack(&entries, 2, 1, mDataPack);
 
     for (c = 0; c < entries; ++c)
     {
         Uint8 stringSize = 0;
 
-        fread(&offset, 4, 1, mDataPack);
-        fread(&stringSize, 1, 1, mDataPack);
-        fread(&buffer, stringSize + 1, 1, mDataPack);
+        read_pack(&offset, 4, 1, mDataPack);
+        read_pack(&stringSize, 1, 1, mDataPack);
+        read_pack(&buffer, stringSize + 1, 1, mDataPack);
 
         if (!strcmp(buffer, path))
         {
@@ -98,33 +125,33 @@ found:
 
     fseek(mDataPack, offset, SEEK_SET);
 
-    fread(&size, 4, 1, mDataPack);
+    read_pack(&size, 4, 1, mDataPack);
     toReturn = (Uint8 *) malloc(size);
 
-    fread(toReturn, sizeof(uint8_t), size, mDataPack);
+    read_pack(toReturn, sizeof(uint8_t), size, mDataPack);
     fclose(mDataPack);
 
     return toReturn;
 }
 
-FILE *open_binary_file_from_path(const char * path)
+/* Leaves the pack at the start of the file and stores its size. */
+static FILE *open_entry(const char * path, Uint32 *size)
 {
-    FILE   *mDataPack = fopen(mDataPath, "rb");
+    FILE   *mDataPack = open_pack();
     Uint32  offset    = 0;
     Uint16  entries   = 0;
     char    buffer[85];
     int     c;
-    Uint32  size      = 0;
 
-    fread(&entries, 2, 1, mDataPack);
+    read_pack(&entries, 2, 1, mDataPack);
 
     for (c = 0; c < entries; ++c)
     {
         Uint8 stringSize = 0;
 
-        fread(&offset, 4, 1, mDataPack);
-        fread(&stringSize, 1, 1, mDataPack);
-        fread(&buffer, stringSize + 1, 1, mDataPack);
+        read_pack(&offset, 4, 1, mDataPack);
+        read_pack(&stringSize, 1, 1, mDataPack);
+        read_pack(&buffer, stringSize + 1, 1, mDataPack);
 
         if (!strcmp(buffer, path))
         {
@@ -132,6 +159,7 @@ FILE *open_binary_file_from_path(const char * path)
         }
     }
 
+    fclose(mDataPack);
     return NULL;
 
 found:
@@ -142,7 +170,78 @@ found:
     }
 
     fseek(mDataPack, offset, SEEK_SET);
-    fread(&size, 4, 1, mDataPack);
+    read_pack(size, 4, 1, mDataPack);
 
     return mDataPack;
 }
+
+FILE *open_binary_file_from_path(const char * path)
+{
+    Uint32 size = 0;
+
+    return open_entry(path, &size);
+}
+
+/* Reads no further than the end of the file, even if the buffer is
+ * larger. */
+size_t read_binary_file_from_path(const char * path, Uint8 *buffer, size_t bufferSize)
+{
+    Uint32  size      = 0;
+    FILE   *mDataPack = open_entry(path, &size);
+    size_t  read;
+
+    if (!mDataPack)
+    {
+        return 0;
+    }
+
+    read = read_pack(buffer, sizeof(uint8_t), SDL_min(bufferSize, (size_t)size), mDataPack);
+    fclose(mDataPack);
+
+    return read;
+}
+
+/* Reads the next part of a file opened by open_binary_file_from_path(),
+ * e.g. to stream it. */
+size_t read_binary_chunk(FILE *file, Uint8 *buffer, size_t bufferSize)
+{
+    return read_pack(buffer, sizeof(uint8_t), bufferSize, file);
+}
+
+void close_binary_file(FILE *file)
+{
+    fclose(file);
+}
+
+/* Calls visit() with the name of every file in the pack and returns the
+ * number of files. */
+int list_files(void (*visit)(const char * path, void * data), void * data)
+{
+    FILE   *mDataPack = open_pack();
+    char    buffer[85];
+    int     c;
+    Uint32  offset    = 0;
+    Uint16  entries   = 0;
+
+    if (!mDataPack)
+    {
+        return 0;
+    }
+
+    read_pack(&entries, 2, 1, mDataPack);
+
+    for (c = 0; c < entries; ++c)
+    {
+        Uint8 stringSize = 0;
+
+        read_pack(&offset, 4, 1, mDataPack);
+        read_pack(&stringSize, 1, 1, mDataPack);
+        read_pack(&buffer, stringSize + 1, 1, mDataPack);
+
+        visit(buffer, data);
+    }
+
+    fclose(mDataPack);
+
+    return entries;
+}
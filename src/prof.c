@@ -0,0 +1,144 @@
+/** @file prof.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Frame profiler.  Sections of a frame are timed with the performance
+ *  counter and summed up per frame; the most recent frames are kept in a
+ *  ring buffer.  The render thread adds its sections to whichever frame
+ *  is open at the time.  Only integer arithmetic is used, since the
+ *  N-Gage has no FPU.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include <stb_sprintf.h>
+#include "ngine.h"
+
+static const char* section_label[PROF_SECTION_COUNT] = { "input", "sim", "snap", "scene", "text", "pres" };
+
+static Uint32 get_elapsed_us(Uint64 start, Uint64 end, profiler_t* prof)
+{
+    return (Uint32)(((end - start) * 1000000) / prof->frequency);
+}
+
+void init_profiler(ngine_t* core)
+{
+    profiler_t* prof = &core->prof;
+
+    SDL_memset(prof, 0, sizeof(struct profiler));
+
+    prof->frequency   = SDL_GetPerformanceFrequency();
+    prof->frame_start = SDL_GetPerformanceCounter();
+}
+
+// Closes the current frame and opens the next one.  The draw count is
+// taken from the statistics, which are closed first.
+void next_profile_frame(ngine_t* core)
+{
+    profiler_t*   prof  = &core->prof;
+    Uint64        now   = SDL_GetPerformanceCounter();
+    prof_frame_t* frame = &prof->frame[prof->head];
+    Sint32        index;
+
+    for (index = 0; index < PROF_SECTION_COUNT; index += 1)
+    {
+        frame->section_us[index] = (Uint32)SDL_AtomicSet(&prof->section_us[index], 0);
+    }
+    frame->draw_count = core->stats.frame[STAT_DRAWS];
+    frame->frame_us   = get_elapsed_us(prof->frame_start, now, prof);
+
+    trace_event("frame", "frame", prof->frame_start, core);
+
+    prof->frame_start = now;
+    prof->head        = (prof->head + 1) % NG_PROF_FRAMES;
+    prof->count       = SDL_min(prof->count + 1, NG_PROF_FRAMES);
+}
+
+Uint64 begin_profile(void)
+{
+    return SDL_GetPerformanceCounter();
+}
+
+// Safe to call from the render thread.
+void end_profile(prof_section_t section, Uint64 start, ngine_t* core)
+{
+    SDL_AtomicAdd(&core->prof.section_us[section], (int)get_elapsed_us(start, SDL_GetPerformanceCounter(), &core->prof));
+    trace_event("section", section_label[section], start, core);
+}
+
+// Microseconds as milliseconds with two decimals.
+static Sint32 append_ms(char* text, Sint32 size, const char* label, Uint32 us)
+{
+    return stbsp_snprintf(text, size, "%-5s%3u.%02u", label, us / 1000, (us % 1000) / 10);
+}
+
+// Per-section averages and the minimum, average and 99th percentile of
+// the frame time over the recorded frames, in ms.  Returns the length
+// of the text.
+Sint32 format_profile_stats(char* text, Sint32 size, ngine_t* core)
+{
+    profiler_t* prof   = &core->prof;
+    Uint32      sorted[NG_PROF_FRAMES];
+    Uint32      sum[PROF_SECTION_COUNT];
+    Uint32      frame_sum = 0;
+    Sint32      draw_sum  = 0;
+    Sint32      length    = 0;
+    Sint32      count     = SDL_max(prof->count, 1);
+    Sint32      index;
+    Sint32      section;
+
+    SDL_memset(sum, 0, sizeof(sum));
+    sorted[0] = 0;
+
+    for (index = 0; index < prof->count; index += 1)
+    {
+        prof_frame_t* frame = &prof->frame[index];
+        Uint32        value = frame->frame_us;
+        Sint32        pos   = index - 1;
+
+        for (section = 0; section < PROF_SECTION_COUNT; section += 1)
+        {
+            sum[section] += frame->section_us[section];
+        }
+        frame_sum += frame->frame_us;
+        draw_sum  += frame->draw_count;
+
+        // Insertion sort for the percentile.
+        while (pos >= 0 && sorted[pos] > value)
+        {
+            sorted[pos + 1] = sorted[pos];
+            pos -= 1;
+        }
+        sorted[pos + 1] = value;
+    }
+
+    for (section = 0; section < PROF_SECTION_COUNT && length < size; section += 1)
+    {
+        length += append_ms(text + length, size - length, section_label[section], sum[section] / (Uint32)count);
+        length += stbsp_snprintf(text + length, SDL_max(size - length, 0), (section & 1) ? "\n" : " ");
+    }
+
+    if (length < size)
+    {
+        length += append_ms(text + length, size - length, "min", sorted[0]);
+        length += stbsp_snprintf(text + length, SDL_max(size - length, 0), " ");
+    }
+
+    if (length < size)
+    {
+        length += append_ms(text + length, size - length, "avg", frame_sum / (Uint32)count);
+        length += stbsp_snprintf(text + length, SDL_max(size - length, 0), "\n");
+    }
+
+    if (length < size)
+    {
+        length += append_ms(text + length, size - length, "p99", sorted[((count - 1) * 99) / 100]);
+        length += stbsp_snprintf(text + length, SDL_max(size - length, 0), " draw%5d\n", draw_sum / count);
+    }
+
+    return SDL_min(length, size - 1);
+}
@@ -0,0 +1,450 @@
+/** @file render.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Hand-over of simulation snapshots to the renderer.  Snapshots are
+ *  triple-buffered, so that the simulation never waits for the renderer
+ *  and the renderer always picks up the most recent complete frame.
+ *  Where SDL threads are available, rendering and presentation can run
+ *  on a thread of their own.  That thread then owns the renderer: it is
+ *  re-created there, and textures are created and destroyed there on
+ *  behalf of the simulation (see call_renderer()).
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include "ngine.h"
+
+#if ! defined __SYMBIAN32__ && ! defined SDL_THREADS_DISABLED
+#define NG_HAS_RENDER_THREAD
+#endif
+
+static void lock(SDL_mutex* mutex)
+{
+    if (mutex)
+    {
+        SDL_LockMutex(mutex);
+    }
+}
+
+static void unlock(SDL_mutex* mutex)
+{
+    if (mutex)
+    {
+        SDL_UnlockMutex(mutex);
+    }
+}
+
+status_t init_renderer(ngine_t* core)
+{
+    status_t status = NG_OK;
+
+    core->renderer = SDL_CreateRenderer(core->window, 0, SDL_RENDERER_SOFTWARE);
+    if (! core->renderer)
+    {
+        //SDL_Log("Could not create renderer: %s", SDL_GetError());
+        return NG_ERROR;
+    }
+    if (0 != SDL_RenderSetIntegerScale(core->renderer, SDL_TRUE))
+    {
+        //SDL_Log("Could not enable integer scale: %s", SDL_GetError());
+        status = NG_WARNING;
+    }
+
+    if (NG_OK != load_font(core))
+    {
+        return NG_ERROR;
+    }
+
+    return status;
+}
+
+// Textures of the map are destroyed with the map.
+status_t free_renderer(ngine_t* core)
+{
+    destroy_texture(&core->font_texture, core);
+    destroy_texture(&core->render_target, core);
+
+    if (core->renderer)
+    {
+        SDL_DestroyRenderer(core->renderer);
+        core->renderer = NULL;
+    }
+
+    return NG_OK;
+}
+
+// Runs the function on the thread that owns the renderer and waits for
+// it.  Calls are run between two frames, even while the renderer is
+// locked.
+status_t call_renderer(render_call_t function, ngine_t* core)
+{
+    render_t* render = &core->render;
+    status_t  status;
+
+    if (! render->is_threaded)
+    {
+        return function(core);
+    }
+
+    SDL_LockMutex(render->buffer_lock);
+
+    render->call = function;
+    SDL_CondSignal(render->is_ready);
+
+    while (render->call)
+    {
+        SDL_CondWait(render->is_done, render->buffer_lock);
+    }
+    status = render->call_status;
+
+    SDL_UnlockMutex(render->buffer_lock);
+
+    return status;
+}
+
+// Keeps the render thread from rendering, e.g. while a map is being
+// loaded or unloaded.  Waits for the frame being rendered, if any.
+void lock_renderer(ngine_t* core)
+{
+    render_t* render = &core->render;
+
+    if (! render->is_threaded)
+    {
+        return;
+    }
+
+    SDL_LockMutex(render->buffer_lock);
+
+    render->pause_count += 1;
+
+    while (render->is_rendering)
+    {
+        SDL_CondWait(render->is_done, render->buffer_lock);
+    }
+
+    SDL_UnlockMutex(render->buffer_lock);
+}
+
+void unlock_renderer(ngine_t* core)
+{
+    render_t* render = &core->render;
+
+    if (! render->is_threaded)
+    {
+        return;
+    }
+
+    SDL_LockMutex(render->buffer_lock);
+
+    render->pause_count -= 1;
+    SDL_CondSignal(render->is_ready);
+
+    SDL_UnlockMutex(render->buffer_lock);
+}
+
+status_t alloc_snapshots(ngine_t* core)
+{
+    Sint32 index;
+
+    for (index = 0; index < NG_SNAPSHOT_COUNT; index += 1)
+    {
+        snapshot_t* snapshot = &core->render.snapshot[index];
+
+        snapshot->entity_capacity = core->map->entity.capacity;
+        snapshot->tile_capacity   = core->map->animated_tile_index;
+        snapshot->tile_version    = (Uint32)-1;
+
+        if (snapshot->entity_capacity > 0)
+        {
+            snapshot->entity = (draw_entity_t*)calloc_memory((size_t)snapshot->entity_capacity, sizeof(struct draw_entity), MEM_RENDER, core);
+            if (! snapshot->entity)
+            {
+                //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+                return NG_ERROR;
+            }
+        }
+
+        if (snapshot->tile_capacity > 0)
+        {
+            snapshot->tile = (draw_tile_t*)calloc_memory((size_t)snapshot->tile_capacity, sizeof(struct draw_tile), MEM_RENDER, core);
+            if (! snapshot->tile)
+            {
+                //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+                return NG_ERROR;
+            }
+        }
+    }
+
+    return NG_OK;
+}
+
+void free_snapshots(ngine_t* core)
+{
+    Sint32 index;
+
+    lock(core->render.buffer_lock);
+
+    for (index = 0; index < NG_SNAPSHOT_COUNT; index += 1)
+    {
+        snapshot_t* snapshot = &core->render.snapshot[index];
+
+        free_memory(snapshot->entity, core);
+        free_memory(snapshot->tile, core);
+
+        snapshot->entity          = NULL;
+        snapshot->entity_count    = 0;
+        snapshot->entity_capacity = 0;
+        snapshot->tile            = NULL;
+        snapshot->tile_count      = 0;
+        snapshot->tile_capacity   = 0;
+        snapshot->is_map_loaded   = SDL_FALSE;
+    }
+
+    // Nothing left to render from the old map.
+    core->render.is_fresh = SDL_FALSE;
+
+    unlock(core->render.buffer_lock);
+}
+
+static void publish_snapshot(ngine_t* core)
+{
+    render_t* render = &core->render;
+    Sint32    write;
+
+    lock(render->buffer_lock);
+
+    write            = render->write;
+    render->write    = render->ready;
+    render->ready    = write;
+    render->is_fresh = SDL_TRUE;
+
+    if (render->is_ready)
+    {
+        SDL_CondSignal(render->is_ready);
+    }
+
+    unlock(render->buffer_lock);
+}
+
+// Returns the snapshot to render; the most recent one if a new one has
+// been published since.
+static const snapshot_t* acquire_snapshot(ngine_t* core)
+{
+    render_t* render = &core->render;
+    Sint32    read;
+
+    lock(render->buffer_lock);
+
+    if (render->is_fresh)
+    {
+        read             = render->read;
+        render->read     = render->ready;
+        render->ready    = read;
+        render->is_fresh = SDL_FALSE;
+    }
+
+    unlock(render->buffer_lock);
+
+    return &render->snapshot[render->read];
+}
+
+#ifdef NG_HAS_RENDER_THREAD
+static int render_thread(void* data)
+{
+    ngine_t*  core   = (ngine_t*)data;
+    render_t* render = &core->render;
+
+    for (;;)
+    {
+        render_call_t call;
+        status_t      status;
+
+        SDL_LockMutex(render->buffer_lock);
+        while (! render->quit && ! render->call && (! render->is_fresh || render->pause_count > 0))
+        {
+            SDL_CondWait(render->is_ready, render->buffer_lock);
+        }
+
+        if (render->quit)
+        {
+            SDL_UnlockMutex(render->buffer_lock);
+            break;
+        }
+
+        // The caller waits for calls, so they come first.
+        call = render->call;
+        if (call)
+        {
+            SDL_UnlockMutex(render->buffer_lock);
+            status = call(core);
+            SDL_LockMutex(render->buffer_lock);
+
+            render->call_status = status;
+            render->call        = NULL;
+            SDL_CondBroadcast(render->is_done);
+            SDL_UnlockMutex(render->buffer_lock);
+            continue;
+        }
+
+        render->is_rendering = SDL_TRUE;
+        SDL_UnlockMutex(render->buffer_lock);
+
+        status = render_snapshot(acquire_snapshot(core), core);
+
+        SDL_LockMutex(render->buffer_lock);
+        render->is_rendering = SDL_FALSE;
+
+        // Reported back to the simulation by the next present_frame().
+        if (NG_OK != status)
+        {
+            render->status = status;
+        }
+
+        SDL_CondBroadcast(render->is_done);
+        SDL_UnlockMutex(render->buffer_lock);
+    }
+
+    return 0;
+}
+#endif
+
+// The renderer, if any, is left to the caller.
+void free_render_thread(ngine_t* core)
+{
+#ifdef NG_HAS_RENDER_THREAD
+    render_t* render = &core->render;
+
+    if (render->thread)
+    {
+        call_renderer(free_renderer, core);
+
+        SDL_LockMutex(render->buffer_lock);
+        render->quit = SDL_TRUE;
+        SDL_CondSignal(render->is_ready);
+        SDL_UnlockMutex(render->buffer_lock);
+
+        SDL_WaitThread(render->thread, NULL);
+        render->thread = NULL;
+    }
+
+    if (render->is_done)
+    {
+        SDL_DestroyCond(render->is_done);
+        render->is_done = NULL;
+    }
+
+    if (render->is_ready)
+    {
+        SDL_DestroyCond(render->is_ready);
+        render->is_ready = NULL;
+    }
+
+    if (render->buffer_lock)
+    {
+        SDL_DestroyMutex(render->buffer_lock);
+        render->buffer_lock = NULL;
+    }
+
+    render->is_threaded  = SDL_FALSE;
+    render->is_rendering = SDL_FALSE;
+    render->pause_count  = 0;
+#else
+    (void)core;
+#endif
+}
+
+// The renderer and its textures are re-created on the thread that is
+// going to use them, so this is only possible while no map is loaded.
+status_t ng_use_render_thread(SDL_bool enable, ngine_t* core)
+{
+#ifdef NG_HAS_RENDER_THREAD
+    render_t* render = &core->render;
+    status_t  status;
+
+    if (enable == render->is_threaded)
+    {
+        return NG_OK;
+    }
+
+    if (is_map_loaded(core))
+    {
+        //SDL_Log("%s: unload map first.", FUNCTION_NAME);
+        return NG_WARNING;
+    }
+
+    if (! enable)
+    {
+        free_render_thread(core);
+        return init_renderer(core);
+    }
+
+    render->buffer_lock = SDL_CreateMutex();
+    render->is_ready    = SDL_CreateCond();
+    render->is_done     = SDL_CreateCond();
+    render->call        = NULL;
+    render->quit        = SDL_FALSE;
+    render->status      = NG_OK;
+
+    if (! render->buffer_lock || ! render->is_ready || ! render->is_done)
+    {
+        //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
+        free_render_thread(core);
+        return NG_WARNING;
+    }
+
+    free_renderer(core);
+
+    render->thread = SDL_CreateThread(render_thread, "render", core);
+    if (! render->thread)
+    {
+        //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
+        free_render_thread(core);
+        return (NG_ERROR == init_renderer(core)) ? NG_ERROR : NG_WARNING;
+    }
+
+    render->is_threaded = SDL_TRUE;
+
+    status = call_renderer(init_renderer, core);
+    if (NG_ERROR == status)
+    {
+        free_render_thread(core);
+        return (NG_ERROR == init_renderer(core)) ? NG_ERROR : NG_WARNING;
+    }
+
+    return status;
+#else
+    (void)core;
+    return enable ? NG_WARNING : NG_OK;
+#endif
+}
+
+// Captures the state of the current frame and either renders it right
+// away or hands it over to the render thread.
+status_t present_frame(ngine_t* core)
+{
+    render_t* render = &core->render;
+    status_t  status;
+
+    Uint64    start  = begin_profile();
+
+    build_snapshot(&render->snapshot[render->write], core);
+    publish_snapshot(core);
+    end_profile(PROF_SNAPSHOT, start, core);
+
+    if (render->is_threaded)
+    {
+        lock(render->buffer_lock);
+        status         = render->status;
+        render->status = NG_OK;
+        unlock(render->buffer_lock);
+
+        return status;
+    }
+
+    return render_snapshot(acquire_snapshot(core), core);
+}
@@ -0,0 +1,204 @@
+/** @file replay.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Deterministic input recording and replay.  The key state of every
+ *  tick is stored run-length encoded; while recording or replaying the
+ *  engine runs on a fixed clock, so that a replay reproduces the
+ *  recorded session exactly.
+ *
+ *  File layout (little endian):
+ *    Uint32 magic, Uint16 version, Uint16 tick length in ms,
+ *    followed by runs of { Uint16 tick count, Uint8 keys down,
+ *    Uint8 keys pressed }.  A tick count of zero ends the file.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include "ngine.h"
+
+#define REPLAY_MAGIC   0x5052474e // "NGRP"
+#define REPLAY_VERSION 1
+
+static void flush_run(replay_t* replay)
+{
+    if (0 == replay->run_length)
+    {
+        return;
+    }
+
+    SDL_WriteLE16(replay->file, (Uint16)replay->run_length);
+    SDL_WriteU8(replay->file,   replay->run_down);
+    SDL_WriteU8(replay->file,   replay->run_pressed);
+
+    replay->run_length = 0;
+}
+
+status_t ng_start_recording(const char* file_name, ngine_t* core)
+{
+    replay_t* replay = &core->replay;
+
+    ng_stop_replay(core);
+
+    replay->file = SDL_RWFromFile(file_name, "wb");
+    if (! replay->file)
+    {
+        //SDL_Log("Could not open %s: %s", file_name, SDL_GetError());
+        return NG_WARNING;
+    }
+
+    SDL_WriteLE32(replay->file, REPLAY_MAGIC);
+    SDL_WriteLE16(replay->file, REPLAY_VERSION);
+    SDL_WriteLE16(replay->file, NG_REPLAY_TICK_MS);
+
+    replay->mode    = REPLAY_RECORD;
+    replay->tick_ms = NG_REPLAY_TICK_MS;
+    replay->tick    = 0;
+
+    return NG_OK;
+}
+
+status_t ng_start_replay(const char* file_name, ngine_t* core)
+{
+    replay_t* replay = &core->replay;
+
+    ng_stop_replay(core);
+
+    replay->file = SDL_RWFromFile(file_name, "rb");
+    if (! replay->file)
+    {
+        //SDL_Log("Could not open %s: %s", file_name, SDL_GetError());
+        return NG_WARNING;
+    }
+
+    if (REPLAY_MAGIC != SDL_ReadLE32(replay->file) || REPLAY_VERSION != SDL_ReadLE16(replay->file))
+    {
+        //SDL_Log("%s is not a valid replay file.", file_name);
+        SDL_RWclose(replay->file);
+        replay->file = NULL;
+        return NG_WARNING;
+    }
+
+    replay->tick_ms = SDL_ReadLE16(replay->file);
+    if (0 == replay->tick_ms)
+    {
+        replay->tick_ms = NG_REPLAY_TICK_MS;
+    }
+
+    replay->mode        = REPLAY_PLAY;
+    replay->run_length  = 0;
+    replay->tick        = 0;
+
+    // Start from a clean slate: keys held before the replay started
+    // must not leak into it.
+    SDL_memset(&core->input, 0, sizeof(struct input));
+
+    return NG_OK;
+}
+
+void ng_stop_replay(ngine_t* core)
+{
+    replay_t* replay = &core->replay;
+
+    if (REPLAY_RECORD == replay->mode)
+    {
+        flush_run(replay);
+        SDL_WriteLE16(replay->file, 0);
+    }
+
+    if (replay->file)
+    {
+        SDL_RWclose(replay->file);
+        replay->file = NULL;
+    }
+
+    replay->mode       = REPLAY_OFF;
+    replay->run_length = 0;
+}
+
+SDL_bool is_replay_active(ngine_t* core)
+{
+    return (REPLAY_OFF != core->replay.mode) ? SDL_TRUE : SDL_FALSE;
+}
+
+// Records the input state of the current tick, or replaces it with the
+// recorded one.  Returns NG_EXIT once a replay has finished.
+status_t update_replay(ngine_t* core)
+{
+    replay_t* replay = &core->replay;
+    input_t*  input  = &core->input;
+
+    switch (replay->mode)
+    {
+        case REPLAY_OFF:
+            return NG_OK;
+
+        case REPLAY_RECORD:
+        {
+            Uint8 down    = (Uint8)(input->keys_down    & 0xff);
+            Uint8 pressed = (Uint8)(input->keys_pressed & 0xff);
+
+            if (replay->run_length > 0 && replay->run_length < 0xffff && down == replay->run_down && pressed == replay->run_pressed)
+            {
+                replay->run_length += 1;
+            }
+            else
+            {
+                flush_run(replay);
+                replay->run_length  = 1;
+                replay->run_down    = down;
+                replay->run_pressed = pressed;
+            }
+            break;
+        }
+
+        case REPLAY_PLAY:
+        {
+            Uint32 prev_down = input->keys_down;
+            Uint32 quit      = input->keys_pressed & NG_KEY_EXIT;
+            Uint32 key;
+
+            if (0 == replay->run_length)
+            {
+                replay->run_length  = SDL_ReadLE16(replay->file);
+                replay->run_down    = SDL_ReadU8(replay->file);
+                replay->run_pressed = SDL_ReadU8(replay->file);
+
+                if (0 == replay->run_length)
+                {
+                    ng_stop_replay(core);
+                    return NG_EXIT;
+                }
+            }
+
+            replay->run_length   -= 1;
+            input->keys_down      = replay->run_down;
+            input->keys_pressed   = replay->run_pressed | quit;
+            input->keys_released  = (prev_down | input->keys_pressed) & ~input->keys_down;
+
+            // Re-create the discrete events.  Presses within the same
+            // tick are replayed in key order.
+            input->head  = 0;
+            input->count = 0;
+            for (key = 1; key <= NG_KEY_OTHER; key <<= 1)
+            {
+                if (input->keys_pressed & key)
+                {
+                    input->queue[input->count].timestamp = core->time_a;
+                    input->queue[input->count].key       = key;
+                    input->queue[input->count].is_down   = SDL_TRUE;
+                    input->count                        += 1;
+                }
+            }
+            break;
+        }
+    }
+
+    replay->tick += 1;
+
+    return NG_OK;
+}
@@ -0,0 +1,282 @@
+/** @file sched.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Time-sliced entity behaviour scheduler.  Every entity with a
+ *  behaviour is updated at its own rate; entities close to the camera
+ *  are served first, the remaining ones round-robin across frames until
+ *  the frame's time budget is used up.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include "ngine.h"
+
+// Walking speed of NPCs in pixels per second.
+#define NPC_SPEED       30
+
+static Uint32 get_random(entity_brain_t* brain)
+{
+    // xorshift32
+    brain->seed ^= brain->seed << 13;
+    brain->seed ^= brain->seed >> 17;
+    brain->seed ^= brain->seed << 5;
+
+    return brain->seed;
+}
+
+static SDL_bool is_due(entity_brain_t* brain, Uint32 time)
+{
+    return ((Sint32)(time - brain->next_update) >= 0) ? SDL_TRUE : SDL_FALSE;
+}
+
+static SDL_bool is_near_camera(Sint32 index, ngine_t* core)
+{
+    Sint32 pos_x = core->map->entity.pos_x[index];
+    Sint32 pos_y = core->map->entity.pos_y[index];
+
+    if (pos_x < core->camera.pos_x - NG_SCHED_NEAR_MARGIN || pos_x > core->camera.pos_x + 176 + NG_SCHED_NEAR_MARGIN)
+    {
+        return SDL_FALSE;
+    }
+
+    if (pos_y < core->camera.pos_y - NG_SCHED_NEAR_MARGIN || pos_y > core->camera.pos_y + 208 + NG_SCHED_NEAR_MARGIN)
+    {
+        return SDL_FALSE;
+    }
+
+    return SDL_TRUE;
+}
+
+static Sint32 get_cell(Sint32 pos_x, Sint32 pos_y, ngine_t* core)
+{
+    Sint32 col;
+    Sint32 row;
+
+    if (pos_x < 0 || pos_y < 0)
+    {
+        return -1;
+    }
+
+    col = pos_x / get_tile_width(core->map->handle);
+    row = pos_y / get_tile_height(core->map->handle);
+
+    if (col >= core->map->tile_attr.cols || row >= core->map->tile_attr.rows)
+    {
+        return -1;
+    }
+
+    return (row * core->map->tile_attr.cols) + col;
+}
+
+static void set_walk_state(Sint32 index, Sint32 offset_x, Sint32 offset_y, ngine_t* core)
+{
+    Uint32* state = &core->map->entity.state[index];
+
+    if (! offset_x && ! offset_y)
+    {
+        CLR_STATE(*state, S_WALK);
+        return;
+    }
+
+    SET_STATE(*state, S_WALK);
+    CLR_STATE(*state, S_UP);
+    CLR_STATE(*state, S_DOWN);
+    CLR_STATE(*state, S_LEFT);
+    CLR_STATE(*state, S_RIGHT);
+
+    if ((offset_x * offset_x) >= (offset_y * offset_y))
+    {
+        SET_STATE(*state, (offset_x > 0) ? S_RIGHT : S_LEFT);
+    }
+    else
+    {
+        SET_STATE(*state, (offset_y > 0) ? S_DOWN : S_UP);
+    }
+}
+
+static void run_wander(Sint32 index, Sint32 step, Uint32 elapsed, ngine_t* core)
+{
+    entity_brain_t* brain = &core->map->entity.brain[index];
+    Sint32          offset_x;
+    Sint32          offset_y;
+    Sint32          target_x;
+    Sint32          target_y;
+
+    if (brain->steps_left <= 0)
+    {
+        static const Sint32 dir_x[5] = { 0, 1, -1, 0,  0 };
+        static const Sint32 dir_y[5] = { 0, 0,  0, 1, -1 };
+        Uint32              choice   = get_random(brain) % 5;
+
+        brain->dir_x      = dir_x[choice];
+        brain->dir_y      = dir_y[choice];
+        brain->steps_left = 500 + (Sint32)(get_random(brain) % 1000);
+    }
+
+    brain->steps_left -= (Sint32)elapsed;
+
+    offset_x = brain->dir_x * step;
+    offset_y = brain->dir_y * step;
+    target_x = core->map->entity.pos_x[index] + offset_x;
+    target_y = core->map->entity.pos_y[index] + offset_y;
+
+    // Tiles outside of the map are never solid: stay inside.
+    if (target_x < 0 || target_y < 0 || target_x >= core->map->width || target_y >= core->map->height)
+    {
+        brain->steps_left = 0;
+        offset_x          = 0;
+        offset_y          = 0;
+    }
+
+    set_walk_state(index, offset_x, offset_y, core);
+    move_entity(get_entity_handle(index, core), offset_x, offset_y, core);
+}
+
+static void run_follow_player(Sint32 index, Sint32 step, ngine_t* core)
+{
+    Sint32 player = get_entity_index(core->map->active_entity, core);
+    Sint32 tile_w = get_tile_width(core->map->handle);
+    Sint32 tile_h = get_tile_height(core->map->handle);
+    Sint32 cell;
+    Sint32 goal;
+    Sint32 dir_x;
+    Sint32 dir_y;
+    Sint32 offset_x;
+    Sint32 offset_y;
+    Sint32 next;
+
+    if (0 > player)
+    {
+        return;
+    }
+
+    cell = get_cell(core->map->entity.pos_x[index],  core->map->entity.pos_y[index],  core);
+    goal = get_cell(core->map->entity.pos_x[player], core->map->entity.pos_y[player], core);
+
+    // Followers sharing the same goal share one flow field.
+    if (0 > cell || 0 > goal || cell == goal || PATH_FOUND != get_flow_direction(goal, cell, &dir_x, &dir_y, core))
+    {
+        set_walk_state(index, 0, 0, core);
+        return;
+    }
+
+    // Head for the centre of the next cell, so that the bounding box
+    // does not catch on corners.
+    next     = cell + dir_x + (dir_y * core->map->tile_attr.cols);
+    offset_x = ((next % core->map->tile_attr.cols) * tile_w) + (tile_w / 2) - core->map->entity.pos_x[index];
+    offset_y = ((next / core->map->tile_attr.cols) * tile_h) + (tile_h / 2) - core->map->entity.pos_y[index];
+    offset_x = SDL_clamp(offset_x, -step, step);
+    offset_y = SDL_clamp(offset_y, -step, step);
+
+    set_walk_state(index, offset_x, offset_y, core);
+    move_entity(get_entity_handle(index, core), offset_x, offset_y, core);
+}
+
+static void run_behaviour(Sint32 index, SDL_bool is_near, ngine_t* core)
+{
+    entity_brain_t* brain   = &core->map->entity.brain[index];
+    Uint32          time    = core->map->scheduler.time;
+    Uint32          elapsed = time - brain->last_update;
+    Sint32          step;
+
+    if (0 == brain->last_update || elapsed > NG_MAX_STEP_TIME)
+    {
+        elapsed = SDL_min(brain->interval, NG_MAX_STEP_TIME);
+    }
+
+    step = SDL_max(1, (Sint32)((elapsed * NPC_SPEED) / 1000));
+
+    switch (brain->behaviour)
+    {
+        case B_WANDER:
+            run_wander(index, step, elapsed, core);
+            break;
+        case B_FOLLOW_PLAYER:
+            run_follow_player(index, step, core);
+            break;
+        case B_NONE:
+            break;
+    }
+
+    brain->last_update = time;
+    brain->next_update = time + (is_near ? brain->interval : brain->interval * NG_SCHED_FAR_DIVISOR);
+}
+
+void update_scheduler(ngine_t* core)
+{
+    scheduler_t* sched  = &core->map->scheduler;
+    Uint64       start  = SDL_GetPerformanceCounter();
+    Uint64       budget = (SDL_GetPerformanceFrequency() * core->behaviour_budget_us) / 1000000;
+    Sint32       count;
+    Sint32       pos;
+
+    if (0 >= core->map->entity_count)
+    {
+        return;
+    }
+
+    sched->time += core->time_since_last_frame;
+
+    // A budget of zero disables the limit.  Replays need to be
+    // deterministic, so they are not bound by wall-clock time.
+    if (0 == core->behaviour_budget_us || is_replay_active(core))
+    {
+        budget = (Uint64)-1;
+    }
+
+    // [1] Entities within or just outside of the viewport.
+    count = query_grid_rect(
+        core->camera.pos_x - NG_SCHED_NEAR_MARGIN,
+        core->camera.pos_y - NG_SCHED_NEAR_MARGIN,
+        176 + (NG_SCHED_NEAR_MARGIN * 2),
+        208 + (NG_SCHED_NEAR_MARGIN * 2),
+        core->map->grid.result,
+        core->map->grid.capacity,
+        core);
+
+    for (pos = 0; pos < count; pos += 1)
+    {
+        Sint32          index = core->map->grid.result[pos];
+        entity_brain_t* brain = &core->map->entity.brain[index];
+
+        if (B_NONE == brain->behaviour || ! is_due(brain, sched->time))
+        {
+            continue;
+        }
+
+        run_behaviour(index, is_near_camera(index, core), core);
+
+        if ((SDL_GetPerformanceCounter() - start) >= budget)
+        {
+            return;
+        }
+    }
+
+    // [2] Round-robin over all entities with the remaining budget.  The
+    // cursor persists, so that every entity is eventually served even if
+    // the budget is exhausted every frame.
+    for (pos = 0; pos < core->map->entity_count; pos += 1)
+    {
+        Sint32          index = sched->cursor;
+        entity_brain_t* brain = &core->map->entity.brain[index];
+
+        sched->cursor = (sched->cursor + 1) % core->map->entity_count;
+
+        if (B_NONE == brain->behaviour || ! is_due(brain, sched->time))
+        {
+            continue;
+        }
+
+        run_behaviour(index, is_near_camera(index, core), core);
+
+        if ((SDL_GetPerformanceCounter() - start) >= budget)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,141 @@
+/** @file stats.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Render and I/O statistics.  Draws, texture switches and pixels are
+ *  counted on the render side, reads from the packed file system by the
+ *  file reader.  The counters are closed once per frame; the share of a
+ *  map load is kept separately.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include <stb_sprintf.h>
+#include "ngine.h"
+
+// Moves the counts of the file reader over.
+static void collect_file_stats(stats_t* stats)
+{
+    int opens;
+    int bytes;
+
+    take_file_reader_stats(&opens, &bytes);
+
+    SDL_AtomicAdd(&stats->counter[STAT_FILE_OPENS], opens);
+    SDL_AtomicAdd(&stats->counter[STAT_FILE_BYTES], bytes);
+}
+
+// Closes the counters of the current frame.
+void next_stats_frame(ngine_t* core)
+{
+    stats_t* stats = &core->stats;
+    Sint32   index;
+
+    collect_file_stats(stats);
+
+    for (index = 0; index < STAT_COUNT; index += 1)
+    {
+        stats->frame[index] = SDL_AtomicSet(&stats->counter[index], 0);
+    }
+}
+
+// A map load happens within a frame and counts towards it as well.
+void begin_stats_load(ngine_t* core)
+{
+    stats_t* stats = &core->stats;
+    Sint32   index;
+
+    collect_file_stats(stats);
+
+    for (index = 0; index < STAT_COUNT; index += 1)
+    {
+        stats->load_start[index] = SDL_AtomicGet(&stats->counter[index]);
+    }
+}
+
+void end_stats_load(ngine_t* core)
+{
+    stats_t* stats = &core->stats;
+    Sint32   index;
+
+    collect_file_stats(stats);
+
+    for (index = 0; index < STAT_COUNT; index += 1)
+    {
+        stats->load[index] = SDL_AtomicGet(&stats->counter[index]) - stats->load_start[index];
+    }
+}
+
+// Render side only.  A texture of NULL is a fill or clear; dst NULL
+// covers the entire render target.
+void count_draw(const SDL_Texture* texture, const SDL_Rect* dst, ngine_t* core)
+{
+    stats_t* stats = &core->stats;
+    SDL_Rect viewport;
+    SDL_Rect visible;
+
+    SDL_AtomicAdd(&stats->counter[STAT_DRAWS], 1);
+
+    if (texture && texture != stats->last_texture)
+    {
+        SDL_AtomicAdd(&stats->counter[STAT_TEXTURE_SWITCHES], 1);
+        stats->last_texture = texture;
+    }
+
+    SDL_RenderGetViewport(core->renderer, &viewport);
+    viewport.x = 0;
+    viewport.y = 0;
+
+    if (! dst)
+    {
+        SDL_AtomicAdd(&stats->counter[STAT_PIXELS], viewport.w * viewport.h);
+    }
+    else if (SDL_IntersectRect(dst, &viewport, &visible))
+    {
+        SDL_AtomicAdd(&stats->counter[STAT_PIXELS], visible.w * visible.h);
+    }
+}
+
+// For draws without an area, such as outlines.
+void count_stat(stat_t stat, Sint32 amount, ngine_t* core)
+{
+    SDL_AtomicAdd(&core->stats.counter[stat], amount);
+}
+
+// Counts of the last completed frame and of the last map load.
+void ng_get_stats(stat_t stat, Sint32* frame, Sint32* load, ngine_t* core)
+{
+    if (stat >= STAT_COUNT)
+    {
+        return;
+    }
+
+    *frame = core->stats.frame[stat];
+    *load  = core->stats.load[stat];
+}
+
+// Draws and texture switches of the last frame, pixels and bytes in
+// units of 1024, followed by the reads of the last map load.  Returns
+// the length of the text.
+Sint32 format_stats(char* text, Sint32 size, ngine_t* core)
+{
+    stats_t* stats = &core->stats;
+
+    return SDL_min(
+        stbsp_snprintf(
+            text,
+            size,
+            "draw%5d  switch%5d\nfill%5dK  read%3d%5dK\nload%3d files%7dK\n",
+            stats->frame[STAT_DRAWS],
+            stats->frame[STAT_TEXTURE_SWITCHES],
+            (stats->frame[STAT_PIXELS] + 1023) / 1024,
+            stats->frame[STAT_FILE_OPENS],
+            (stats->frame[STAT_FILE_BYTES] + 1023) / 1024,
+            stats->load[STAT_FILE_OPENS],
+            (stats->load[STAT_FILE_BYTES] + 1023) / 1024),
+        size - 1);
+}
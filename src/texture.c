@@ -0,0 +1,191 @@
+/** @file texture.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Texture residency.  Every texture is created through here and counts
+ *  against the texture budget (see ng_set_memory_budget()).  Textures
+ *  that can be re-created, such as the baked map layer or sprite sheets,
+ *  are registered in a slot and evicted least recently used first when
+ *  the budget is exceeded or the renderer runs out of memory.  Evicted
+ *  textures are re-created as soon as they are used again.
+ *
+ *  All of this happens with the renderer locked.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include "ngine.h"
+
+// Textures in use by the current frame are never evicted.
+static SDL_bool evict_texture(ngine_t* core)
+{
+    texture_cache_t* cache  = &core->textures;
+    texture_slot_t*  oldest = NULL;
+    Sint32           index;
+
+    for (index = 0; index < cache->slot_count; index += 1)
+    {
+        texture_slot_t* slot = &cache->slot[index];
+
+        if (! *slot->texture || slot->last_used == cache->frame)
+        {
+            continue;
+        }
+
+        if (! oldest || (Sint32)(slot->last_used - oldest->last_used) < 0)
+        {
+            oldest = slot;
+        }
+    }
+
+    if (! oldest)
+    {
+        return SDL_FALSE;
+    }
+
+    destroy_texture(oldest->texture, core);
+    cache->eviction_count += 1;
+
+    return SDL_TRUE;
+}
+
+static void make_room(Sint32 size, ngine_t* core)
+{
+    mem_usage_t* usage = &core->mem[MEM_TEXTURE];
+
+    while (usage->budget > 0 && SDL_AtomicGet(&usage->current) + size > usage->budget)
+    {
+        if (! evict_texture(core))
+        {
+            break;
+        }
+    }
+}
+
+// Returns NULL if the texture could not be created even after evicting
+// everything that is not in use.
+SDL_Texture* create_texture(Uint32 format, int access, int width, int height, ngine_t* core)
+{
+    SDL_Texture* texture;
+    Uint64       start = begin_profile();
+
+    make_room(width * height * (Sint32)SDL_BYTESPERPIXEL(format), core);
+
+    for (;;)
+    {
+        texture = SDL_CreateTexture(core->renderer, format, access, width, height);
+        if (texture || ! evict_texture(core))
+        {
+            break;
+        }
+    }
+
+    if (! texture)
+    {
+        //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
+        core->textures.failure_count += 1;
+        return NULL;
+    }
+
+    track_texture(texture, core);
+    trace_event("texture", "create", start, core);
+    return texture;
+}
+
+SDL_Texture* create_texture_from_surface(SDL_Surface* surface, ngine_t* core)
+{
+    SDL_Texture* texture;
+    Uint64       start = begin_profile();
+
+    make_room(surface->w * surface->h * (Sint32)surface->format->BytesPerPixel, core);
+
+    for (;;)
+    {
+        texture = SDL_CreateTextureFromSurface(core->renderer, surface);
+        if (texture || ! evict_texture(core))
+        {
+            break;
+        }
+    }
+
+    if (! texture)
+    {
+        //SDL_Log("%s: %s.", FUNCTION_NAME, SDL_GetError());
+        core->textures.failure_count += 1;
+        return NULL;
+    }
+
+    track_texture(texture, core);
+    trace_event("texture", "create", start, core);
+    return texture;
+}
+
+// Makes the texture evictable.  Returns the slot or -1 if there is no
+// slot left, in which case the texture simply stays resident.
+Sint32 register_texture(SDL_Texture** texture, texture_loader_t reload, Sint32 index, ngine_t* core)
+{
+    texture_cache_t* cache = &core->textures;
+    texture_slot_t*  slot;
+
+    if (cache->slot_count >= NG_MAX_TEXTURES)
+    {
+        //SDL_Log("%s: too many textures.", FUNCTION_NAME);
+        return -1;
+    }
+
+    slot            = &cache->slot[cache->slot_count];
+    slot->texture   = texture;
+    slot->reload    = reload;
+    slot->index     = index;
+    slot->last_used = cache->frame;
+
+    cache->slot_count += 1;
+
+    return cache->slot_count - 1;
+}
+
+// The textures themselves are destroyed by their owners.
+void clear_textures(ngine_t* core)
+{
+    core->textures.slot_count = 0;
+}
+
+// Called once per rendered frame.
+void next_texture_frame(ngine_t* core)
+{
+    core->textures.frame += 1;
+}
+
+// Marks the texture of a slot as used by the current frame and re-creates
+// it if it has been evicted.  Returns NG_WARNING if that fails: the
+// caller is expected to do without the texture for this frame.
+status_t use_texture(Sint32 slot, ngine_t* core)
+{
+    texture_cache_t* cache = &core->textures;
+    texture_slot_t*  entry;
+
+    if (0 > slot || slot >= cache->slot_count)
+    {
+        return NG_OK;
+    }
+
+    entry            = &cache->slot[slot];
+    entry->last_used = cache->frame;
+
+    if (*entry->texture)
+    {
+        return NG_OK;
+    }
+
+    if (NG_OK != entry->reload(entry->index, core))
+    {
+        destroy_texture(entry->texture, core);
+        return NG_WARNING;
+    }
+
+    return NG_OK;
+}
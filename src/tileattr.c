@@ -0,0 +1,172 @@
+/** @file tileattr.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Packed per-tile attribute grid.  Every attribute is stored as a
+ *  separate bit plane with rows padded to 32-bit words, so that row and
+ *  rectangle queries can test up to 32 tiles at once.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include "ngine.h"
+
+// Mask of all bits from first_bit to last_bit (inclusive) of a word.
+static Uint32 get_span_mask(Sint32 first_bit, Sint32 last_bit)
+{
+    Uint32 mask = 0xffffffffU << first_bit;
+
+    if (last_bit < 31)
+    {
+        mask &= (0xffffffffU >> (31 - last_bit));
+    }
+
+    return mask;
+}
+
+status_t alloc_tile_attr(Sint32 cols, Sint32 rows, ngine_t* core)
+{
+    tile_attr_grid_t* grid = &core->map->tile_attr;
+    Sint32            plane_size;
+    Sint32            attr;
+
+    grid->cols          = cols;
+    grid->rows          = rows;
+    grid->words_per_row = (cols + 31) / 32;
+    plane_size          = grid->words_per_row * rows;
+
+    if (0 >= plane_size)
+    {
+        return NG_OK;
+    }
+
+    grid->plane[0] = (Uint32*)calloc_memory((size_t)(plane_size * TA_COUNT), sizeof(Uint32), MEM_MAP, core);
+    if (! grid->plane[0])
+    {
+        //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+        return NG_ERROR;
+    }
+
+    for (attr = 1; attr < TA_COUNT; attr += 1)
+    {
+        grid->plane[attr] = grid->plane[attr - 1] + plane_size;
+    }
+
+    return NG_OK;
+}
+
+void free_tile_attr(ngine_t* core)
+{
+    free_memory(core->map->tile_attr.plane[0], core);
+    SDL_memset(&core->map->tile_attr, 0, sizeof(struct tile_attr_grid));
+}
+
+void set_tile_attr(tile_attr_t attr, Sint32 col, Sint32 row, SDL_bool enable, ngine_t* core)
+{
+    tile_attr_grid_t* grid = &core->map->tile_attr;
+    Uint32*           word;
+
+    if (col < 0 || row < 0 || col >= grid->cols || row >= grid->rows)
+    {
+        return;
+    }
+
+    word = &grid->plane[attr][(row * grid->words_per_row) + (col >> 5)];
+
+    if (enable)
+    {
+        *word |= (1U << (col & 31));
+    }
+    else
+    {
+        *word &= ~(1U << (col & 31));
+    }
+
+    core->map->version += 1;
+}
+
+// Tiles outside of the map never have any attributes set.
+SDL_bool is_tile_attr_set(tile_attr_t attr, Sint32 col, Sint32 row, ngine_t* core)
+{
+    tile_attr_grid_t* grid = &core->map->tile_attr;
+
+    if (col < 0 || row < 0 || col >= grid->cols || row >= grid->rows)
+    {
+        return SDL_FALSE;
+    }
+
+    if (grid->plane[attr][(row * grid->words_per_row) + (col >> 5)] & (1U << (col & 31)))
+    {
+        return SDL_TRUE;
+    }
+
+    return SDL_FALSE;
+}
+
+SDL_bool is_row_attr_set(tile_attr_t attr, Sint32 row, Sint32 first_col, Sint32 last_col, ngine_t* core)
+{
+    tile_attr_grid_t* grid = &core->map->tile_attr;
+    Uint32*           line;
+    Sint32            first_word;
+    Sint32            last_word;
+    Sint32            word;
+
+    if (row < 0 || row >= grid->rows)
+    {
+        return SDL_FALSE;
+    }
+
+    first_col = SDL_max(first_col, 0);
+    last_col  = SDL_min(last_col,  grid->cols - 1);
+
+    if (first_col > last_col)
+    {
+        return SDL_FALSE;
+    }
+
+    line       = &grid->plane[attr][row * grid->words_per_row];
+    first_word = first_col >> 5;
+    last_word  = last_col  >> 5;
+
+    if (first_word == last_word)
+    {
+        return (line[first_word] & get_span_mask(first_col & 31, last_col & 31)) ? SDL_TRUE : SDL_FALSE;
+    }
+
+    if (line[first_word] & get_span_mask(first_col & 31, 31))
+    {
+        return SDL_TRUE;
+    }
+
+    for (word = first_word + 1; word < last_word; word += 1)
+    {
+        if (line[word])
+        {
+            return SDL_TRUE;
+        }
+    }
+
+    return (line[last_word] & get_span_mask(0, last_col & 31)) ? SDL_TRUE : SDL_FALSE;
+}
+
+SDL_bool is_rect_attr_set(tile_attr_t attr, Sint32 first_col, Sint32 first_row, Sint32 last_col, Sint32 last_row, ngine_t* core)
+{
+    Sint32 row;
+
+    first_row = SDL_max(first_row, 0);
+    last_row  = SDL_min(last_row,  core->map->tile_attr.rows - 1);
+
+    for (row = first_row; row <= last_row; row += 1)
+    {
+        if (is_row_attr_set(attr, row, first_col, last_col, core))
+        {
+            return SDL_TRUE;
+        }
+    }
+
+    return SDL_FALSE;
+}
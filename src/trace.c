@@ -0,0 +1,170 @@
+/** @file trace.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Capture of timing markers in the Chrome trace-event format, to be
+ *  opened with Perfetto or about:tracing.  Frames, profiler sections,
+ *  load jobs, resource reads and texture creation are recorded into a
+ *  fixed buffer, which is written out when the capture is stopped.
+ *  Events beyond the capacity of the buffer are dropped.
+ *
+ *  Only available on the host.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include <stb_sprintf.h>
+#include "ngine.h"
+
+#if ! defined __SYMBIAN32__
+#define NG_HAS_TRACE
+#endif
+
+#ifdef NG_HAS_TRACE
+static Uint64 get_trace_us(Uint64 ticks, ngine_t* core)
+{
+    return (ticks * 1000000) / core->prof.frequency;
+}
+
+static void write_trace(ngine_t* core)
+{
+    trace_t* trace = &core->trace;
+    Sint32   count = SDL_min(SDL_AtomicGet(&trace->count), NG_TRACE_EVENTS);
+    Sint32   index;
+    char     line[192];
+    Sint32   length;
+
+    length = stbsp_snprintf(line, sizeof(line), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    SDL_RWwrite(trace->file, line, 1, (size_t)length);
+
+    for (index = 0; index < count; index += 1)
+    {
+        trace_event_t* event = &trace->event[index];
+
+        length = stbsp_snprintf(
+            line,
+            sizeof(line),
+            "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":1,\"tid\":%u}\n",
+            (index > 0) ? "," : "",
+            event->name,
+            event->category,
+            (unsigned long long)get_trace_us(event->start - trace->base, core),
+            (unsigned long long)get_trace_us(event->end - event->start, core),
+            event->thread);
+
+        SDL_RWwrite(trace->file, line, 1, (size_t)length);
+    }
+
+    length = stbsp_snprintf(line, sizeof(line), "]}\n");
+    SDL_RWwrite(trace->file, line, 1, (size_t)length);
+}
+#endif
+
+status_t ng_start_trace(const char* file_name, ngine_t* core)
+{
+#ifdef NG_HAS_TRACE
+    trace_t* trace = &core->trace;
+
+    ng_stop_trace(core);
+
+    trace->event = (trace_event_t*)alloc_memory(NG_TRACE_EVENTS * sizeof(struct trace_event), MEM_SCRATCH, core);
+    if (! trace->event)
+    {
+        //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+        return NG_WARNING;
+    }
+
+    trace->file = SDL_RWFromFile(file_name, "wb");
+    if (! trace->file)
+    {
+        //SDL_Log("Could not open %s: %s", file_name, SDL_GetError());
+        free_memory(trace->event, core);
+        trace->event = NULL;
+        return NG_WARNING;
+    }
+
+    SDL_AtomicSet(&trace->count, 0);
+    trace->base      = SDL_GetPerformanceCounter();
+    trace->is_active = SDL_TRUE;
+
+    return NG_OK;
+#else
+    (void)file_name;
+    (void)core;
+    return NG_WARNING;
+#endif
+}
+
+// Writes the capture to the file given to ng_start_trace().
+void ng_stop_trace(ngine_t* core)
+{
+#ifdef NG_HAS_TRACE
+    trace_t* trace = &core->trace;
+
+    if (! trace->file)
+    {
+        return;
+    }
+
+    // Keeps the render thread from recording while the events are
+    // written; the job workers only run while the caller waits.
+    lock_renderer(core);
+    trace->is_active = SDL_FALSE;
+    unlock_renderer(core);
+
+    write_trace(core);
+    SDL_RWclose(trace->file);
+    trace->file = NULL;
+
+    free_memory(trace->event, core);
+    trace->event = NULL;
+#else
+    (void)core;
+#endif
+}
+
+// Records an event from start until now.  Safe to call from any thread.
+void trace_event(const char* category, const char* name, Uint64 start, ngine_t* core)
+{
+#ifdef NG_HAS_TRACE
+    trace_t*       trace = &core->trace;
+    trace_event_t* event;
+    Sint32         index;
+    Sint32         pos;
+
+    if (! trace->is_active)
+    {
+        return;
+    }
+
+    index = SDL_AtomicAdd(&trace->count, 1);
+    if (index >= NG_TRACE_EVENTS)
+    {
+        return;
+    }
+
+    // Events that began before the capture, such as the frame it was
+    // started in, are cut off at its start.
+    event           = &trace->event[index];
+    event->category = category;
+    event->start    = SDL_max(start, trace->base);
+    event->end      = SDL_GetPerformanceCounter();
+    event->thread   = (Uint32)SDL_ThreadID();
+
+    // Names end up in a JSON string.
+    for (pos = 0; pos < NG_TRACE_NAME_SIZE - 1 && name && '\0' != name[pos]; pos += 1)
+    {
+        event->name[pos] = ('"' == name[pos] || '\\' == name[pos] || 0x20 > (Uint8)name[pos]) ? '_' : name[pos];
+    }
+    event->name[pos] = '\0';
+#else
+    (void)category;
+    (void)name;
+    (void)start;
+    (void)core;
+#endif
+}
@@ -0,0 +1,285 @@
+/** @file trigger.c
+ *
+ *  N-GINE, a portable game engine which is being developed specifically
+ *  for the Nokia N-Gage.
+ *
+ *  Tile-indexed trigger table.  Triggers are resolved once at load time
+ *  and looked up by tile, so that the cost of an action does not depend
+ *  on the number of objects on the map.
+ *
+ *  Copyright (c) 2022, Michael Fitzmayer. All rights reserved.
+ *  SPDX-License-Identifier: MIT
+ *
+ **/
+
+#include <SDL.h>
+#include "ngine.h"
+
+// Fibonacci hashing: the upper bits of the product are well mixed.
+static Uint32 get_home_slot(Sint32 tile, trigger_table_t* table)
+{
+    return ((Uint32)tile * 2654435769U) >> (32 - table->bits);
+}
+
+static void insert_slot(Sint32 tile, Sint32 trigger, trigger_table_t* table)
+{
+    Uint32 pos = get_home_slot(tile, table);
+
+    while (0 <= table->slot[pos].tile)
+    {
+        pos = (pos + 1) & table->mask;
+    }
+
+    table->slot[pos].tile    = tile;
+    table->slot[pos].trigger = trigger;
+}
+
+// Linear probing with backward-shift deletion: no tombstones are left
+// behind, so that lookups stay short while triggers move around.
+static void remove_slot(Sint32 tile, Sint32 trigger, trigger_table_t* table)
+{
+    Uint32 pos = get_home_slot(tile, table);
+    Uint32 next;
+
+    while (0 <= table->slot[pos].tile)
+    {
+        if (table->slot[pos].tile == tile && table->slot[pos].trigger == trigger)
+        {
+            break;
+        }
+        pos = (pos + 1) & table->mask;
+    }
+
+    if (0 > table->slot[pos].tile)
+    {
+        return;
+    }
+
+    next = (pos + 1) & table->mask;
+    while (0 <= table->slot[next].tile)
+    {
+        Uint32 home = get_home_slot(table->slot[next].tile, table);
+
+        // Move the entry back if its home slot does not lie cyclically
+        // within (pos, next].
+        if ((pos <= next) ? (home <= pos || home > next) : (home <= pos && home > next))
+        {
+            table->slot[pos] = table->slot[next];
+            pos              = next;
+        }
+        next = (next + 1) & table->mask;
+    }
+
+    table->slot[pos].tile    = -1;
+    table->slot[pos].trigger = -1;
+}
+
+// Tiles covered by the region of the owning entity.
+static void get_trigger_region(trigger_t* entry, Sint32* first_col, Sint32* first_row, Sint32* last_col, Sint32* last_row, ngine_t* core)
+{
+    Sint32 pos_x  = core->map->entity.pos_x[entry->entity];
+    Sint32 pos_y  = core->map->entity.pos_y[entry->entity];
+    Sint32 tile_w = get_tile_width(core->map->handle);
+    Sint32 tile_h = get_tile_height(core->map->handle);
+
+    *first_col = floor_div(pos_x, tile_w);
+    *first_row = floor_div(pos_y, tile_h);
+    *last_col  = floor_div(pos_x + entry->width  - 1, tile_w);
+    *last_row  = floor_div(pos_y + entry->height - 1, tile_h);
+}
+
+static void place_trigger(Sint32 trigger, SDL_bool enable, ngine_t* core)
+{
+    trigger_table_t* table = &core->map->triggers;
+    trigger_t*       entry = &table->trigger[trigger];
+    Sint32           col;
+    Sint32           row;
+
+    // Only the part of the region inside of the map is indexed.
+    for (row = SDL_max(entry->first_row, 0); row <= SDL_min(entry->last_row, core->map->tile_attr.rows - 1); row += 1)
+    {
+        for (col = SDL_max(entry->first_col, 0); col <= SDL_min(entry->last_col, core->map->tile_attr.cols - 1); col += 1)
+        {
+            Sint32 tile = (row * core->map->tile_attr.cols) + col;
+
+            if (enable)
+            {
+                insert_slot(tile, trigger, table);
+            }
+            else
+            {
+                remove_slot(tile, trigger, table);
+            }
+        }
+    }
+}
+
+status_t alloc_triggers(Sint32 trigger_count, Sint32 slot_count, ngine_t* core)
+{
+    trigger_table_t* table = &core->map->triggers;
+    Sint32           size  = 16;
+    Sint32           index;
+
+    SDL_memset(table, 0, sizeof(struct trigger_table));
+    table->entity_count = core->map->entity_count;
+
+    if (0 >= trigger_count)
+    {
+        return NG_OK;
+    }
+
+    // Keep the load factor at or below one half.
+    table->bits = 4;
+    while (size < slot_count * 2)
+    {
+        size        *= 2;
+        table->bits += 1;
+    }
+    table->mask = (Uint32)(size - 1);
+
+    table->trigger        = (trigger_t*)calloc_memory((size_t)trigger_count, sizeof(struct trigger), MEM_MAP, core);
+    table->slot           = (trigger_slot_t*)alloc_memory((size_t)size * sizeof(struct trigger_slot), MEM_MAP, core);
+    table->entity_trigger = (Sint32*)alloc_memory((size_t)table->entity_count * sizeof(Sint32), MEM_MAP, core);
+
+    if (! table->trigger || ! table->slot || ! table->entity_trigger)
+    {
+        //SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+        free_triggers(core);
+        return NG_ERROR;
+    }
+
+    SDL_memset(table->slot,           0xff, (size_t)size * sizeof(struct trigger_slot));
+    SDL_memset(table->entity_trigger, 0xff, (size_t)table->entity_count * sizeof(Sint32));
+
+    table->capacity = trigger_count;
+
+    for (index = 0; index < trigger_count; index += 1)
+    {
+        table->trigger[index].entity = -1;
+    }
+
+    return NG_OK;
+}
+
+void free_triggers(ngine_t* core)
+{
+    trigger_table_t* table = &core->map->triggers;
+
+    free_memory(table->trigger, core);
+    free_memory(table->slot, core);
+    free_memory(table->entity_trigger, core);
+    SDL_memset(table, 0, sizeof(struct trigger_table));
+}
+
+void add_trigger(Sint32 entity, trigger_type_t type, const char* text, Sint32 width, Sint32 height, ngine_t* core)
+{
+    trigger_table_t* table = &core->map->triggers;
+    trigger_t*       entry;
+
+    if (table->count >= table->capacity || 0 > entity || entity >= table->entity_count)
+    {
+        return;
+    }
+
+    entry         = &table->trigger[table->count];
+    entry->text   = text;
+    entry->type   = type;
+    entry->entity = entity;
+    entry->width  = SDL_max(width,  1);
+    entry->height = SDL_max(height, 1);
+
+    get_trigger_region(entry, &entry->first_col, &entry->first_row, &entry->last_col, &entry->last_row, core);
+
+    table->entity_trigger[entity] = table->count;
+    place_trigger(table->count, SDL_TRUE, core);
+
+    table->count += 1;
+}
+
+// Re-indexes the trigger owned by the given entity after it has moved.
+void update_trigger_entity(Sint32 entity, ngine_t* core)
+{
+    trigger_table_t* table = &core->map->triggers;
+    trigger_t*       entry;
+    Sint32           trigger;
+    Sint32           first_col;
+    Sint32           first_row;
+    Sint32           last_col;
+    Sint32           last_row;
+
+    if (0 > entity || entity >= table->entity_count || ! table->entity_trigger)
+    {
+        return;
+    }
+
+    trigger = table->entity_trigger[entity];
+    if (0 > trigger)
+    {
+        return;
+    }
+
+    entry = &table->trigger[trigger];
+    get_trigger_region(entry, &first_col, &first_row, &last_col, &last_row, core);
+
+    if (first_col == entry->first_col && first_row == entry->first_row && last_col == entry->last_col && last_row == entry->last_row)
+    {
+        return;
+    }
+
+    place_trigger(trigger, SDL_FALSE, core);
+    entry->first_col = first_col;
+    entry->first_row = first_row;
+    entry->last_col  = last_col;
+    entry->last_row  = last_row;
+    place_trigger(trigger, SDL_TRUE, core);
+}
+
+// Disables the trigger owned by a despawned entity.  Its slot in the
+// table is not reused.
+void remove_trigger_entity(Sint32 entity, ngine_t* core)
+{
+    trigger_table_t* table = &core->map->triggers;
+    Sint32           trigger;
+
+    if (0 > entity || entity >= table->entity_count || ! table->entity_trigger)
+    {
+        return;
+    }
+
+    trigger = table->entity_trigger[entity];
+    if (0 > trigger)
+    {
+        return;
+    }
+
+    place_trigger(trigger, SDL_FALSE, core);
+    table->trigger[trigger].entity = -1;
+    table->entity_trigger[entity]  = -1;
+}
+
+const trigger_t* find_trigger(Sint32 col, Sint32 row, ngine_t* core)
+{
+    trigger_table_t* table = &core->map->triggers;
+    Sint32           tile;
+    Uint32           pos;
+
+    if (! table->slot || col < 0 || row < 0 || col >= core->map->tile_attr.cols || row >= core->map->tile_attr.rows)
+    {
+        return NULL;
+    }
+
+    tile = (row * core->map->tile_attr.cols) + col;
+    pos  = get_home_slot(tile, table);
+
+    // If triggers overlap, the one placed first wins.
+    while (0 <= table->slot[pos].tile)
+    {
+        if (table->slot[pos].tile == tile)
+        {
+            return &table->trigger[table->slot[pos].trigger];
+        }
+        pos = (pos + 1) & table->mask;
+    }
+
+    return NULL;
+}
@@ -52,92 +52,143 @@ SDL_bool bb_do_intersect(const aabb_t bb_a, const aabb_t bb_b)
     return SDL_TRUE;
 }
 
-status_t load_texture_from_file(const char* file_name, SDL_Texture** texture, ngine_t* core)
+// Integer division rounding towards negative infinity.
+Sint32 floor_div(Sint32 value, Sint32 divisor)
+{
+    if (value >= 0)
+    {
+        return value / divisor;
+    }
+
+    return -((divisor - 1 - value) / divisor);
+}
+
+// Reads a file from the PFS into scratch memory of the load arena.
+// Release with free_scratch().
+Uint8* load_resource(const char* file_name, Uint32* size, ngine_t* core)
 {
-    Uint8*       resource_buf;
-    SDL_RWops*   resource;
-    SDL_Surface* surface;
+    Uint8* resource_buf;
+    Uint64 start = begin_profile();
+
+    *size        = (Uint32)size_of_file(file_name);
+    resource_buf = (Uint8*)alloc_scratch(*size, &core->load_arena);
+    if (! resource_buf)
+    {
+        // SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
+        return NULL;
+    }
+
+    if (*size != (Uint32)read_binary_file_from_path(file_name, resource_buf, (size_t)*size))
+    {
+        free_scratch(resource_buf, &core->load_arena);
+        return NULL;
+    }
+    trace_event("pfs", file_name, start, core);
+
+    return resource_buf;
+}
+
+// Decoding only touches the surface, so that it may run on any thread.
+status_t load_surface_from_file(const char* file_name, SDL_Surface** surface, ngine_t* core)
+{
+    Uint8*     resource_buf;
+    Uint32     resource_size;
+    SDL_RWops* resource;
 
     if (! file_name)
     {
         return NG_WARNING;
     }
 
-    resource_buf = (Uint8*)load_binary_file_from_path(file_name);
+    resource_buf = load_resource(file_name, &resource_size, core);
     if (! resource_buf)
     {
         // SDL_Log("Failed to load resource: %s", file_name);
         return NG_ERROR;
     }
 
-    resource = SDL_RWFromConstMem((Uint8*)resource_buf, size_of_file(file_name));
+    resource = SDL_RWFromConstMem((Uint8*)resource_buf, (int)resource_size);
     if (! resource)
     {
-        free(resource_buf);
+        free_scratch(resource_buf, &core->load_arena);
         // SDL_Log("Failed to convert resource %s: %s", file_name, SDL_GetError());
         return NG_ERROR;
     }
 
-    surface = SDL_LoadBMP_RW(resource, SDL_TRUE);
-    if (! surface)
+    *surface = SDL_LoadBMP_RW(resource, SDL_TRUE);
+    if (! *surface)
     {
-        free(resource_buf);
+        free_scratch(resource_buf, &core->load_arena);
         // SDL_Log("Failed to load image: %s", SDL_GetError());
         return NG_ERROR;
     }
-    free(resource_buf);
+    free_scratch(resource_buf, &core->load_arena);
 
-    if (0 != SDL_SetColorKey(surface, SDL_TRUE, SDL_MapRGB(surface->format, 0xff, 0x00, 0xff)))
+    if (0 != SDL_SetColorKey(*surface, SDL_TRUE, SDL_MapRGB((*surface)->format, 0xff, 0x00, 0xff)))
     {
         // SDL_Log("Failed to set color key for %s: %s", file_name, SDL_GetError());
     }
-    if (0 != SDL_SetSurfaceRLE(surface, 1))
+    if (0 != SDL_SetSurfaceRLE(*surface, 1))
     {
         // SDL_Log("Could not enable RLE for surface %s: %s", file_name, SDL_GetError());
     }
 
-    *texture = SDL_CreateTextureFromSurface(core->renderer, surface);
+    return NG_OK;
+}
+
+// Textures belong to the renderer and have to be created on the thread
+// that owns it.  The surface is released in any case.
+status_t load_texture_from_surface(SDL_Surface** surface, SDL_Texture** texture, ngine_t* core)
+{
+    if (! *surface)
+    {
+        return NG_WARNING;
+    }
+
+    *texture = create_texture_from_surface(*surface, core);
+    SDL_FreeSurface(*surface);
+    *surface = NULL;
+
     if (! *texture)
     {
         // SDL_Log("Could not create texture from surface: %s", SDL_GetError());
-        SDL_FreeSurface(surface);
         return NG_ERROR;
     }
-    SDL_FreeSurface(surface);
-
-    // SDL_Log("Loading image from file: %s.", file_name);
 
     return NG_OK;
 }
 
-status_t set_display_text(const char* text, ngine_t* core)
+status_t load_texture_from_file(const char* file_name, SDL_Texture** texture, ngine_t* core)
 {
-    size_t text_length = strlen(text);
+    SDL_Surface* surface = NULL;
+    status_t     status;
 
-    if (text_length > 144)
+    status = load_surface_from_file(file_name, &surface, core);
+    if (NG_OK != status)
     {
-        text_length = 144;
+        return status;
     }
 
-    core->display_text = (unsigned char*)calloc(text_length + 1, sizeof(unsigned char));
-    if (! core->display_text)
-    {
-        // SDL_Log("%s: error allocating memory.", FUNCTION_NAME);
-        return NG_ERROR;
-    }
+    // SDL_Log("Loading image from file: %s.", file_name);
 
-    stbsp_snprintf(core->display_text, text_length + 1, "%s", text);
+    return load_texture_from_surface(&surface, texture, core);
+}
+
+status_t set_display_text(const char* text, ngine_t* core)
+{
+    // Whatever does not fit into the text box is cut off.
+    stbsp_snprintf(core->display_text, NG_DISPLAY_TEXT_SIZE, "%s", text);
 
     return NG_OK;
 }
 
 void clear_display_text(ngine_t* core)
 {
-    core->display_text = NULL;
+    core->display_text[0] = '\0';
 }
 
 // Error handling: yes or no?
-void render_text(ngine_t* core)
+void render_text(const char* text, ngine_t* core)
 {
     SDL_Rect textbox      = { 0, 144, 176, 64 };
     SDL_Rect border_a     = { 0, 144, 176, 64 };
@@ -149,23 +200,25 @@ void render_text(ngine_t* core)
 
     SDL_SetRenderDrawColor(core->renderer, 0xff, 0xff, 0xff, 0x00);
     SDL_RenderFillRect(core->renderer, &textbox);
+    count_draw(NULL, &textbox, core);
     SDL_RenderDrawRect(core->renderer, &textbox);
     SDL_SetRenderDrawColor(core->renderer, 0x00, 0x00, 0x00, 0x00);
     SDL_RenderDrawRect(core->renderer, &border_a);
     SDL_RenderDrawRect(core->renderer, &border_b);
+    count_stat(STAT_DRAWS, 3, core);
 
     for (row = 0; row < 6; row += 1)
     {
         dst.x = 4;
         for (col = 0; col < 24; col += 1)
         {
-            if ('\0' == core->display_text[string_index])
+            if ('\0' == text[string_index])
             {
                 goto no_text_left;
             }
-            get_character_position(core->display_text[string_index], &src.x, &src.y);
+            get_character_position(text[string_index], &src.x, &src.y);
 
-            if (' ' == core->display_text[string_index] && (4 == dst.x))
+            if (' ' == text[string_index] && (4 == dst.x))
             {
                 dst.x -= 7;
                 col   -= 1;
@@ -173,9 +226,42 @@ void render_text(ngine_t* core)
             string_index += 1;
 
             SDL_RenderCopy(core->renderer, core->font_texture, &src, &dst);
+            count_draw(core->font_texture, &dst, core);
             dst.x += 7;
         }
         dst.y += 9;
     }
 no_text_left:
 }
+
+// Plain text on a white background, one line per '\n'.
+void render_debug_text(const char* text, Sint32 pos_x, Sint32 pos_y, ngine_t* core)
+{
+    SDL_Rect src          = { 0, 0, 7, 9 };
+    SDL_Rect dst          = { 0, 0, 7, 9 };
+    int      string_index = 0;
+
+    dst.x = pos_x;
+    dst.y = pos_y;
+
+    SDL_SetRenderDrawColor(core->renderer, 0xff, 0xff, 0xff, 0x00);
+
+    while ('\0' != text[string_index])
+    {
+        if ('\n' == text[string_index])
+        {
+            dst.x  = pos_x;
+            dst.y += 9;
+        }
+        else if (dst.x < 176)
+        {
+            get_character_position(text[string_index], &src.x, &src.y);
+            SDL_RenderFillRect(core->renderer, &dst);
+            SDL_RenderCopy(core->renderer, core->font_texture, &src, &dst);
+            count_draw(NULL, &dst, core);
+            count_draw(core->font_texture, &dst, core);
+            dst.x += 7;
+        }
+        string_index += 1;
+    }
+}